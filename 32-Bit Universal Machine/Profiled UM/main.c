@@ -10,7 +10,20 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
-#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef UM_GUARD
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+#ifdef UM_SAMPLE
+#include <signal.h>
+#include <sys/time.h>
+#endif
+#include "bulk_memory.h"
+#include "fork_server.h"
+#include "splice_output.h"
+#include "umx_cache.h"
 
 #define CONDITIONAL_MOVE 0
 #define SEGMENTED_LOAD 1
@@ -26,12 +39,20 @@
 #define INPUT 11
 #define LOAD_PROGRAM 12
 #define LOAD_VALUE 13
+#define BLOCK 14                /* Extension, see instruction_set.h */
+#define OUTPUT_BLOCK 15
+
+#define BLOCK_COPY 0
+#define BLOCK_FILL 1
 
 typedef unsigned UM_Reg;
 typedef uint32_t UM_instruction;
 
 #define mod_limit 4294967296;
 
+/* Pipe size asked for with -p */
+#define SPLICE_OUTPUT_BYTES (1 << 20)
+
 static inline uint64_t Bitpack_getu(uint64_t word, unsigned width, unsigned lsb)
 {
         return (word << (64 - (lsb + width))) >> (64 - width); 
@@ -43,43 +64,884 @@ static inline uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb,
         return (word ^= Bitpack_getu(word, width, lsb) << lsb) | (value << lsb);
 }
 
-int main(int argc, char *argv[])
+#if defined(UM_PROFILE) || defined(UM_SAMPLE)
+/* Name: write_code_snapshot
+ * Purpose: Save one generation of code as <image>.g<N>.um for umdis
+ * Parameters: Path of the program image, generation, copy of segment zero
+ *             (length at index 0)
+ * Returns: none
+ * Effects: Checked runtime error if the file cannot be written
+ */
+static void write_code_snapshot(const char *image_path, uint32_t generation,
+                                const uint32_t *code)
 {
-        if (argc != 2) exit(EXIT_FAILURE);
+        char code_path[4096];
+        snprintf(code_path, sizeof(code_path), "%s.g%" PRIu32 ".um",
+                 image_path, generation);
+        FILE *fp = fopen(code_path, "wb");
+        assert(fp);
 
-        /**** LOAD PROGRAM ****/
-        FILE *fp = fopen(argv[1], "rb");
+        for (uint32_t i = 1; i <= code[0]; i++) {
+                uint32_t word = code[i];
+                for (int lsb = 24; lsb >= 0; lsb -= 8)
+                        fputc((word >> lsb) & 0xff, fp);
+        }
+        fclose(fp);
+}
+#endif
+
+#ifdef UM_PROFILE
+/* Instrumented build (make um-prof): count every executed instruction per
+   program counter. Each LOAD_PROGRAM that replaces segment zero starts a new
+   generation of code, which gets its own counts and a snapshot of its words
+   so that umdis can annotate it. Generations past the limit are only counted
+   in aggregate. */
+#define PROFILE_MAX_GENERATIONS 64
+
+static uint64_t *profile_counts[PROFILE_MAX_GENERATIONS];
+static uint32_t *profile_code[PROFILE_MAX_GENERATIONS];
+static uint32_t profile_lengths[PROFILE_MAX_GENERATIONS];
+static uint32_t profile_generations = 0;
+static uint64_t profile_untracked = 0;
+
+/* Name: profile_start_generation
+ * Purpose: Allocate counts for the code now in segment zero
+ * Parameters: Segment zero (length at index 0, words after it)
+ * Returns: Count array to use, or NULL once the generation limit is reached
+ * Effects: Checked runtime error if allocation fails
+ */
+static uint64_t *profile_start_generation(uint32_t *segment_zero)
+{
+        uint32_t generation = profile_generations++;
+
+        if (generation >= PROFILE_MAX_GENERATIONS)
+                return NULL;
+
+        profile_lengths[generation] = segment_zero[0];
+        profile_counts[generation] = calloc(segment_zero[0] + 1,
+                                            sizeof(uint64_t));
+        assert(profile_counts[generation]);
+
+        /* Generation 0 is the program file itself and needs no snapshot */
+        if (generation > 0) {
+                size_t bytes = (segment_zero[0] + 1) * sizeof(uint32_t);
+                profile_code[generation] = malloc(bytes);
+                assert(profile_code[generation]);
+                memcpy(profile_code[generation], segment_zero, bytes);
+        }
+
+        return profile_counts[generation];
+}
+
+/* Name: profile_write
+ * Purpose: Write <image>.prof in the format read by umdis, plus a
+ *          big-endian <image>.g<N>.um snapshot of each later generation
+ * Parameters: Path of the program image
+ * Returns: none
+ * Effects: Summary on stderr, checked runtime error if a file cannot be
+ *          written
+ */
+static void profile_write(const char *image_path)
+{
+        char path[4096];
+        uint64_t total = profile_untracked;
+
+        snprintf(path, sizeof(path), "%s.prof", image_path);
+        FILE *fp = fopen(path, "w");
         assert(fp);
 
-        struct stat file_info;
-        stat(argv[1], &file_info);
+        uint32_t tracked = profile_generations < PROFILE_MAX_GENERATIONS ?
+                           profile_generations : PROFILE_MAX_GENERATIONS;
+
+        fprintf(fp, "# umprof 1\n# image %s\n# generations %" PRIu32 "\n",
+                image_path, profile_generations);
+        fprintf(fp, "# untracked %" PRIu64 "\n", profile_untracked);
+
+        for (uint32_t gen = 0; gen < tracked; gen++) {
+                uint32_t length = profile_lengths[gen];
+
+                for (uint32_t pc = 0; pc < length; pc++) {
+                        uint64_t count = profile_counts[gen][pc];
+                        total += count;
+                        if (count != 0)
+                                fprintf(fp, "%" PRIu32 " %" PRIu32 " %"
+                                        PRIu64 "\n", gen, pc, count);
+                }
+
+                if (gen > 0)
+                        write_code_snapshot(image_path, gen, profile_code[gen]);
+
+                free(profile_counts[gen]);
+                free(profile_code[gen]);
+        }
+
+        fclose(fp);
+
+        fprintf(stderr, "um: %" PRIu64 " instructions in %" PRIu32
+                " generations, profile written to %s\n",
+                total, profile_generations, path);
+}
+#endif
+
+#ifdef UM_HEATMAP
+/* Instrumented build (make um-heat): count SEGMENTED_LOAD and
+   SEGMENTED_STORE traffic per segment, along with each word the block copy,
+   fill and output opcodes read or write, in log2 buckets of the offset, and
+   charge it to the MAP_SEGMENT instruction (generation and program counter)
+   that created the segment. A segment's counts are folded into its map site
+   when it is unmapped or at HALT, and the hottest individual segments are
+   kept for the report. Segment zero is charged to a site of its own. */
+#define HEAT_BUCKETS 33   /* Offset 0, then [2^(b-1), 2^b) for b = 1..32 */
+#define HEAT_TOP 16       /* Hottest segments listed in the report */
+#define HEAT_PROGRAM_PC UINT32_MAX
+
+typedef struct heat_site {
+        uint32_t generation;
+        uint32_t pc;            /* HEAT_PROGRAM_PC for segment zero */
+        uint64_t segments;      /* Segments mapped here */
+        uint64_t words;         /* Total length of those segments */
+        uint64_t sequential;    /* Accesses at the previous offset + 1 */
+        uint64_t loads[HEAT_BUCKETS];
+        uint64_t stores[HEAT_BUCKETS];
+} heat_site;
+
+typedef struct heat_segment {
+        bool live;
+        uint32_t id;
+        uint32_t site;          /* Index into heat_sites */
+        uint32_t length;
+        uint32_t last_offset;
+        uint64_t sequential;
+        uint64_t loads[HEAT_BUCKETS];
+        uint64_t stores[HEAT_BUCKETS];
+} heat_segment;
+
+static heat_segment *heat_segments = NULL;     /* Indexed by segment ID */
+static uint32_t heat_capacity = 0;
+static heat_site *heat_sites = NULL;
+static uint32_t heat_num_sites = 0;
+static uint32_t heat_sites_capacity = 0;
+static heat_segment heat_top[HEAT_TOP];        /* Hottest first */
+static uint32_t heat_num_top = 0;
+static uint32_t heat_generation = 0;
+
+static inline unsigned heat_bucket(uint32_t offset)
+{
+        return offset == 0 ? 0 : 32 - __builtin_clz(offset);
+}
+
+static uint64_t heat_total(const uint64_t *loads, const uint64_t *stores)
+{
+        uint64_t total = 0;
+        for (int b = 0; b < HEAT_BUCKETS; b++)
+                total += loads[b] + stores[b];
+        return total;
+}
+
+/* Name: heat_find_site
+ * Purpose: Find or add the site for a map instruction
+ * Parameters: Generation of segment zero, program counter
+ * Returns: Index of the site
+ * Effects: Checked runtime error if allocation fails. Sites are few, so a
+ *          linear search is fine.
+ */
+static uint32_t heat_find_site(uint32_t generation, uint32_t pc)
+{
+        for (uint32_t i = 0; i < heat_num_sites; i++)
+                if (heat_sites[i].pc == pc &&
+                    heat_sites[i].generation == generation)
+                        return i;
+
+        if (heat_num_sites == heat_sites_capacity) {
+                heat_sites_capacity = heat_sites_capacity * 2 + 8;
+                heat_sites = realloc(heat_sites, heat_sites_capacity *
+                                     sizeof(heat_site));
+                assert(heat_sites);
+        }
+
+        heat_site *site = &heat_sites[heat_num_sites];
+        memset(site, 0, sizeof(*site));
+        site->generation = generation;
+        site->pc = pc;
+
+        return heat_num_sites++;
+}
+
+/* Name: heat_map
+ * Purpose: Start counting a newly mapped segment
+ * Parameters: Segment ID, length, program counter of the MAP_SEGMENT
+ * Returns: none
+ * Effects: Grows the per-ID table as needed
+ */
+static void heat_map(uint32_t id, uint32_t length, uint32_t pc)
+{
+        if (id >= heat_capacity) {
+                uint32_t capacity = heat_capacity * 2 + 64;
+                while (capacity <= id)
+                        capacity *= 2;
+                heat_segments = realloc(heat_segments,
+                                        capacity * sizeof(heat_segment));
+                assert(heat_segments);
+                memset(heat_segments + heat_capacity, 0,
+                       (capacity - heat_capacity) * sizeof(heat_segment));
+                heat_capacity = capacity;
+        }
+
+        heat_segment *seg = &heat_segments[id];
+        memset(seg, 0, sizeof(*seg));
+        seg->live = true;
+        seg->id = id;
+        seg->length = length;
+        seg->last_offset = UINT32_MAX - 1; /* No offset follows it */
+        seg->site = heat_find_site(heat_generation, pc);
+
+        heat_sites[seg->site].segments++;
+        heat_sites[seg->site].words += length;
+}
+
+static inline void heat_access(uint32_t id, uint32_t offset, bool store)
+{
+        heat_segment *seg = &heat_segments[id];
+
+        if (offset == seg->last_offset + 1)
+                seg->sequential++;
+        seg->last_offset = offset;
+
+        if (store)
+                seg->stores[heat_bucket(offset)]++;
+        else
+                seg->loads[heat_bucket(offset)]++;
+}
+
+/* Name: heat_range
+ * Purpose: Count one access to each of count words from offset, as a block
+ *          opcode makes them, without a loop over the words
+ * Parameters: Segment ID, first offset, number of words, store or load
+ * Returns: none
+ * Effects: All but the first word count as sequential, as does the first
+ *          if it follows the segment's last access
+ */
+static void heat_range(uint32_t id, uint32_t offset, uint32_t count,
+                       bool store)
+{
+        heat_segment *seg = &heat_segments[id];
+        uint64_t *counts = store ? seg->stores : seg->loads;
+        uint64_t end = (uint64_t) offset + count;
+
+        if (count == 0)
+                return;
+
+        if (offset == seg->last_offset + 1)
+                seg->sequential++;
+        seg->sequential += count - 1;
+        seg->last_offset = end - 1;
 
-        int num_4byte_words = file_info.st_size / 4;
+        /* Bucket b holds [2^(b-1), 2^b); bucket 0 holds offset 0 alone */
+        for (unsigned b = heat_bucket(offset); b <= heat_bucket(end - 1); b++) {
+                uint64_t low = b == 0 ? 0 : (uint64_t) 1 << (b - 1);
+                uint64_t high = b == 0 ? 1 : (uint64_t) 1 << b;
+                if (low < offset)
+                        low = offset;
+                if (high > end)
+                        high = end;
+                counts[b] += high - low;
+        }
+}
 
-        uint32_t *segment_zero = malloc((num_4byte_words + 1) * sizeof(uint32_t));
-        assert(segment_zero);
+/* Name: heat_unmap
+ * Purpose: Fold a segment's counts into its site and the hottest list
+ * Parameters: Segment ID
+ * Returns: none
+ * Effects: The ID's counts are cleared for reuse
+ */
+static void heat_unmap(uint32_t id)
+{
+        heat_segment *seg = &heat_segments[id];
+        heat_site *site = &heat_sites[seg->site];
 
-        uint32_t instruction = 0;
+        if (!seg->live)
+                return;
 
-        int num_elems = 0;
+        for (int b = 0; b < HEAT_BUCKETS; b++) {
+                site->loads[b] += seg->loads[b];
+                site->stores[b] += seg->stores[b];
+        }
+        site->sequential += seg->sequential;
 
-        int byte = fgetc(fp);
+        /* Insertion into the hottest list, kept sorted */
+        uint64_t total = heat_total(seg->loads, seg->stores);
+        uint32_t i = heat_num_top < HEAT_TOP ? heat_num_top++ : HEAT_TOP;
+        while (i > 0 && heat_total(heat_top[i - 1].loads,
+                                   heat_top[i - 1].stores) < total) {
+                if (i < HEAT_TOP)
+                        heat_top[i] = heat_top[i - 1];
+                i--;
+        }
+        if (i < HEAT_TOP)
+                heat_top[i] = *seg;
 
-        while (byte != EOF) {
+        seg->live = false;
+}
 
-                for (int i = 3; i >= 0; i--) {
-                        instruction = Bitpack_newu(instruction, 8, i * 8, byte);
-                        byte = fgetc(fp);
+static void heat_print_buckets(FILE *fp, const char *label,
+                               const uint64_t *counts)
+{
+        fprintf(fp, "    %-7s", label);
+        for (int b = 0; b < HEAT_BUCKETS; b++)
+                if (counts[b] != 0)
+                        fprintf(fp, " [%" PRIu64 ",%" PRIu64 ") %" PRIu64,
+                                b == 0 ? (uint64_t) 0 : (uint64_t) 1 << (b - 1),
+                                (uint64_t) 1 << b, counts[b]);
+        fprintf(fp, "\n");
+}
+
+static void heat_print_site_name(FILE *fp, const heat_site *site)
+{
+        if (site->pc == HEAT_PROGRAM_PC)
+                fprintf(fp, "segment zero");
+        else
+                fprintf(fp, "g%" PRIu32 ":%08" PRIx32, site->generation,
+                        site->pc);
+}
+
+static int heat_hotter_site(const void *a, const void *b)
+{
+        uint64_t x = heat_total(((const heat_site *) a)->loads,
+                                ((const heat_site *) a)->stores);
+        uint64_t y = heat_total(((const heat_site *) b)->loads,
+                                ((const heat_site *) b)->stores);
+        return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+/* Name: heat_write
+ * Purpose: Fold the live segments and write <image>.heat
+ * Parameters: Path of the program image
+ * Returns: none
+ * Effects: Summary on stderr, checked runtime error if the report cannot
+ *          be written
+ */
+static void heat_write(const char *image_path)
+{
+        for (uint32_t id = 0; id < heat_capacity; id++)
+                heat_unmap(id);
+
+        uint64_t loads = 0, stores = 0;
+        for (uint32_t i = 0; i < heat_num_sites; i++)
+                for (int b = 0; b < HEAT_BUCKETS; b++) {
+                        loads += heat_sites[i].loads[b];
+                        stores += heat_sites[i].stores[b];
                 }
 
-                segment_zero[num_elems + 1] = instruction;
+        /* The top list refers to sites by index, so report it first */
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.heat", image_path);
+        FILE *fp = fopen(path, "w");
+        assert(fp);
+
+        fprintf(fp, "# umheat 1\n# image %s\n# %" PRIu64 " loads, %" PRIu64
+                " stores, %" PRIu32 " map sites\n"
+                "# offset buckets are [low,high) word ranges\n",
+                image_path, loads, stores, heat_num_sites);
+
+        fprintf(fp, "\nHottest segments:\n");
+        for (uint32_t i = 0; i < heat_num_top; i++) {
+                heat_segment *seg = &heat_top[i];
+                uint64_t total = heat_total(seg->loads, seg->stores);
+                if (total == 0)
+                        break;
+
+                fprintf(fp, "  id %-8" PRIu32 " %10" PRIu32 " words  "
+                        "%14" PRIu64 " accesses %6.2f%%  %5.1f%% sequential"
+                        "  mapped at ", seg->id, seg->length, total,
+                        100.0 * total / (loads + stores),
+                        100.0 * seg->sequential / total);
+                heat_print_site_name(fp, &heat_sites[seg->site]);
+                fprintf(fp, "\n");
+                heat_print_buckets(fp, "loads", seg->loads);
+                heat_print_buckets(fp, "stores", seg->stores);
+        }
+
+        qsort(heat_sites, heat_num_sites, sizeof(heat_site),
+              heat_hotter_site);
+
+        fprintf(fp, "\nMap sites by traffic:\n");
+        for (uint32_t i = 0; i < heat_num_sites; i++) {
+                heat_site *site = &heat_sites[i];
+                uint64_t total = heat_total(site->loads, site->stores);
 
-                num_elems++;
+                fprintf(fp, "  ");
+                heat_print_site_name(fp, site);
+                fprintf(fp, "  %" PRIu64 " segments, %.1f words avg, %"
+                        PRIu64 " accesses %.2f%%, %.1f%% sequential\n",
+                        site->segments, site->segments == 0 ? 0.0 :
+                        (double) site->words / site->segments, total,
+                        loads + stores == 0 ? 0.0 :
+                        100.0 * total / (loads + stores),
+                        total == 0 ? 0.0 : 100.0 * site->sequential / total);
+                heat_print_buckets(fp, "loads", site->loads);
+                heat_print_buckets(fp, "stores", site->stores);
         }
 
         fclose(fp);
+        free(heat_sites);
+        free(heat_segments);
+
+        fprintf(stderr, "um: %" PRIu64 " loads and %" PRIu64 " stores from %"
+                PRIu32 " map sites, heatmap written to %s\n",
+                loads, stores, heat_num_sites, path);
+}
+#endif
+
+#ifdef UM_SAMPLE
+/* Sampling build (make um-sample): cheap enough to leave on. The command
+   loop stores the program counter in a volatile slot before every
+   instruction and bumps the generation at each LOAD_PROGRAM that replaces
+   segment zero; a SIGPROF timer (every UM_SAMPLE_US microseconds of CPU
+   time, 1000 by default) counts the slot's current value in a fixed hash
+   table. At HALT the counts go to <image>.samples in the profile format of
+   um-prof, so umdis -p annotates them the same way. Generations that were
+   sampled get a code snapshot when they are replaced, up to a limit. */
+#define SAMPLE_SLOTS (1 << 16)          /* Distinct (generation, pc) pairs */
+#define SAMPLE_PROBES 32
+#define SAMPLE_MAX_SNAPSHOTS 64
+
+static volatile uint32_t sample_pc;
+static volatile uint32_t sample_generation = 0;
+static volatile uint64_t sample_generation_hits = 0;
+static uint64_t sample_keys[SAMPLE_SLOTS];      /* (gen << 32 | pc) + 1 */
+static uint64_t sample_counts[SAMPLE_SLOTS];
+static volatile uint64_t sample_total = 0;
+static volatile uint64_t sample_dropped = 0;
+static uint32_t *sample_code[SAMPLE_MAX_SNAPSHOTS];
+static long sample_interval_us = 1000;
+
+static void sample_tick(int signo)
+{
+        (void) signo;
+
+        uint64_t key = ((uint64_t) sample_generation << 32 | sample_pc) + 1;
+        uint32_t slot = (uint32_t) ((key * 0x9e3779b97f4a7c15u) >> 48);
+
+        sample_total++;
+        sample_generation_hits++;
+
+        for (int probe = 0; probe < SAMPLE_PROBES; probe++) {
+                uint32_t i = (slot + probe) & (SAMPLE_SLOTS - 1);
+                if (sample_keys[i] == key || sample_keys[i] == 0) {
+                        sample_keys[i] = key;
+                        sample_counts[i]++;
+                        return;
+                }
+        }
+        sample_dropped++;
+}
 
-        segment_zero[0] = num_elems;
+/* Name: sample_start
+ * Purpose: Install the SIGPROF handler and start the CPU-time timer
+ * Parameters: none
+ * Returns: none
+ * Effects: Reads UM_SAMPLE_US from the environment
+ */
+static void sample_start(void)
+{
+        const char *interval = getenv("UM_SAMPLE_US");
+        if (interval != NULL && atol(interval) > 0)
+                sample_interval_us = atol(interval);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = sample_tick;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, NULL);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec = sample_interval_us / 1000000;
+        timer.it_interval.tv_usec = sample_interval_us % 1000000;
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+/* Name: sample_new_generation
+ * Purpose: Move the samples on to the code a LOAD_PROGRAM just loaded
+ * Parameters: Outgoing segment zero (length at index 0)
+ * Returns: none
+ * Effects: Snapshots the outgoing code if it was sampled, so umdis can
+ *          show it
+ */
+static void sample_new_generation(const uint32_t *old_segment_zero)
+{
+        uint32_t generation = sample_generation;
+
+        if (generation > 0 && generation < SAMPLE_MAX_SNAPSHOTS &&
+            sample_generation_hits > 0) {
+                size_t bytes = (old_segment_zero[0] + 1) * sizeof(uint32_t);
+                sample_code[generation] = malloc(bytes);
+                assert(sample_code[generation]);
+                memcpy(sample_code[generation], old_segment_zero, bytes);
+        }
+
+        sample_generation_hits = 0;
+        sample_generation = generation + 1;
+}
+
+/* Name: sample_write
+ * Purpose: Stop sampling and write <image>.samples and the snapshots
+ * Parameters: Path of the program image, current segment zero
+ * Returns: none
+ * Effects: Summary on stderr, checked runtime error if a file cannot be
+ *          written
+ */
+static void sample_write(const char *image_path, const uint32_t *segment_zero)
+{
+        struct itimerval off;
+        memset(&off, 0, sizeof(off));
+        setitimer(ITIMER_PROF, &off, NULL);
+        signal(SIGPROF, SIG_IGN);
+
+        /* The last generation is still in segment zero */
+        sample_new_generation(segment_zero);
+        uint32_t generations = sample_generation;
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.samples", image_path);
+        FILE *fp = fopen(path, "w");
+        assert(fp);
+
+        fprintf(fp, "# umprof 1\n# image %s\n# generations %" PRIu32 "\n",
+                image_path, generations);
+        fprintf(fp, "# untracked %" PRIu64 "\n", (uint64_t) sample_dropped);
+        fprintf(fp, "# samples %" PRIu64 " every %ld us of CPU time\n",
+                (uint64_t) sample_total, sample_interval_us);
+
+        for (uint32_t i = 0; i < SAMPLE_SLOTS; i++) {
+                if (sample_keys[i] == 0)
+                        continue;
+                uint64_t key = sample_keys[i] - 1;
+                fprintf(fp, "%" PRIu32 " %" PRIu32 " %" PRIu64 "\n",
+                        (uint32_t) (key >> 32), (uint32_t) key,
+                        sample_counts[i]);
+        }
+        fclose(fp);
+
+        for (uint32_t gen = 1; gen < SAMPLE_MAX_SNAPSHOTS; gen++) {
+                if (sample_code[gen] != NULL) {
+                        write_code_snapshot(image_path, gen, sample_code[gen]);
+                        free(sample_code[gen]);
+                }
+        }
+
+        fprintf(stderr, "um: %" PRIu64 " samples in %" PRIu32
+                " generations, written to %s\n", (uint64_t) sample_total,
+                generations, path);
+}
+#endif
+
+#ifdef UM_GUARD
+/* Checked build (make um-guard): segment accesses stay free of compares,
+   but every segment ends right against a PROT_NONE guard window, so an
+   offset up to UM_GUARD_BYTES past the end faults instead of corrupting
+   memory. Unmapped segment IDs point at a PROT_NONE sentinel, and the
+   segment spine is a reserved region whose unused entries hold the
+   sentinel too, so bad IDs fault as well. A SIGSEGV/SIGBUS/SIGFPE handler
+   on its own stack turns the fault into a UM failure report. Offsets that
+   land beyond the guard window can still reach another mapping and are
+   not caught; offsets are computed in 64 bits so they never wrap back
+   onto the length word. Each segment costs two kernel mappings, so the
+   number of live segments is limited by vm.max_map_count, and spreading
+   small segments a page apart costs TLB reach: sandmark runs about twice
+   as long as in the unchecked build. */
+#ifndef UM_GUARD_BYTES
+#define UM_GUARD_BYTES ((size_t) 64 << 10)    /* Wider spreads segments out */
+#endif
+#define GUARD_SPINE_BYTES (((size_t) 1 << 32) * sizeof(uint32_t *))
+
+static size_t guard_page;
+static uint32_t *guard_sentinel;
+static char **guard_cache;              /* Freed one-page reservations */
+static size_t guard_cached = 0;
+static size_t guard_cache_size = 0;
+static uint32_t **guard_spine;
+static size_t guard_spine_committed = 0;        /* Bytes */
+static volatile uint32_t guard_pc;
+
+static inline size_t guard_data_bytes(uint32_t length)
+{
+        size_t bytes = ((size_t) length + 1) * sizeof(uint32_t);
+        return (bytes + guard_page - 1) / guard_page * guard_page;
+}
+
+/* Name: guard_alloc
+ * Purpose: Make a zeroed segment of length words that ends at a guard
+ * Parameters: Number of words
+ * Returns: Segment with its length at index 0
+ * Effects: Checked runtime error if the kernel refuses the mapping
+ */
+static uint32_t *guard_alloc(uint32_t length)
+{
+        size_t data = guard_data_bytes(length);
+        char *base;
+
+        if (data == guard_page && guard_cached > 0) {
+                base = guard_cache[--guard_cached];
+        } else {
+                base = mmap(NULL, data + UM_GUARD_BYTES, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                            -1, 0);
+                assert(base != MAP_FAILED);
+                int rc = mprotect(base, data, PROT_READ | PROT_WRITE);
+                assert(rc == 0);
+        }
+
+        uint32_t *seg = (uint32_t *) (base + data) - ((size_t) length + 1);
+        memset(seg, 0, ((size_t) length + 1) * sizeof(uint32_t));
+        seg[0] = length;
+
+        return seg;
+}
+
+static void guard_free(uint32_t *seg)
+{
+        if (seg == guard_sentinel)
+                return;
+
+        size_t data = guard_data_bytes(seg[0]);
+        char *base = (char *) (seg + seg[0] + 1) - data;
+
+        /* Programs free one-word segments in bursts of many thousands, and
+           a fresh mapping costs three system calls, so small reservations
+           are always kept */
+        if (data == guard_page) {
+                if (guard_cached == guard_cache_size) {
+                        guard_cache_size = guard_cache_size ? 2 * guard_cache_size : 1024;
+                        guard_cache = realloc(guard_cache, guard_cache_size * sizeof(char *));
+                        assert(guard_cache);
+                }
+                guard_cache[guard_cached++] = base;
+        } else {
+                munmap(base, data + UM_GUARD_BYTES);
+        }
+}
+
+/* Name: guard_grow_spine
+ * Purpose: Make the first entries of the reserved spine usable
+ * Parameters: Number of entries needed
+ * Returns: The spine, which never moves
+ * Effects: New entries point at the sentinel
+ */
+static uint32_t **guard_grow_spine(size_t entries)
+{
+        size_t bytes = entries * sizeof(uint32_t *);
+        bytes = (bytes + guard_page - 1) / guard_page * guard_page;
+
+        if (bytes > guard_spine_committed) {
+                int rc = mprotect((char *) guard_spine + guard_spine_committed,
+                                  bytes - guard_spine_committed,
+                                  PROT_READ | PROT_WRITE);
+                assert(rc == 0);
+
+                for (size_t i = guard_spine_committed / sizeof(uint32_t *);
+                     i < bytes / sizeof(uint32_t *); i++)
+                        guard_spine[i] = guard_sentinel;
+                guard_spine_committed = bytes;
+        }
+
+        return guard_spine;
+}
+
+static void guard_write_hex(char **out, uint64_t value, int digits)
+{
+        for (int i = digits - 1; i >= 0; i--)
+                *(*out)++ = "0123456789abcdef"[(value >> (4 * i)) & 0xf];
+}
+
+static void guard_append(char **out, const char *text)
+{
+        while (*text)
+                *(*out)++ = *text++;
+}
+
+/* Name: guard_fail
+ * Purpose: Report a UM failure at the current program counter and abort
+ * Parameters: What went wrong, faulting address (0 if none)
+ * Returns: Does not return
+ * Effects: Flushes the program's output first; the faults this handles
+ *          come from the command loop, never from inside stdio
+ */
+static void guard_fail(const char *what, uintptr_t address)
+{
+        char message[256];
+        char *out = message;
+        uint32_t pc = guard_pc;
+        uint32_t *segment_zero = guard_spine[0];
+
+        fflush(stdout);
+
+        guard_append(&out, "um: UM failure: ");
+        guard_append(&out, what);
+        guard_append(&out, " at program counter ");
+        guard_write_hex(&out, pc, 8);
+        if (pc < segment_zero[0]) {
+                guard_append(&out, " (instruction ");
+                guard_write_hex(&out, segment_zero[pc + 1], 8);
+                guard_append(&out, ")");
+        }
+        if (address != 0) {
+                guard_append(&out, ", address ");
+                guard_write_hex(&out, address, 16);
+        }
+        guard_append(&out, "\n");
+
+        ssize_t written = write(STDERR_FILENO, message, out - message);
+        (void) written;
+
+        signal(SIGABRT, SIG_DFL);
+        abort();
+}
+
+static void guard_handler(int signo, siginfo_t *info, void *context)
+{
+        (void) context;
+
+        if (signo == SIGFPE)
+                guard_fail("division by zero", 0);
+        else
+                guard_fail("segment access out of bounds or unmapped",
+                           (uintptr_t) info->si_addr);
+}
+
+/* Name: guard_init
+ * Purpose: Reserve the spine and sentinel and install the fault handler
+ * Parameters: none
+ * Returns: The spine, with room for one entry
+ * Effects: Checked runtime error if any of it cannot be set up
+ */
+static uint32_t **guard_init(void)
+{
+        guard_page = sysconf(_SC_PAGESIZE);
+
+        guard_sentinel = mmap(NULL, UM_GUARD_BYTES, PROT_NONE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(guard_sentinel != MAP_FAILED);
+
+        guard_spine = mmap(NULL, GUARD_SPINE_BYTES, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                           -1, 0);
+        assert(guard_spine != MAP_FAILED);
+
+        stack_t alternate;
+        alternate.ss_size = SIGSTKSZ > 65536 ? SIGSTKSZ : 65536;
+        alternate.ss_sp = malloc(alternate.ss_size);
+        alternate.ss_flags = 0;
+        assert(alternate.ss_sp);
+        int rc = sigaltstack(&alternate, NULL);
+        assert(rc == 0);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = guard_handler;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, NULL);
+        sigaction(SIGBUS, &action, NULL);
+        sigaction(SIGFPE, &action, NULL);
+
+        return guard_grow_spine(1);
+}
+
+/* A block range can jump past the guard window, so it is checked whole;
+   reading the length of an unmapped segment faults on the sentinel */
+static inline void guard_range(const uint32_t *segment, uint32_t offset,
+                               uint32_t count)
+{
+        if ((uint64_t) offset + count > segment[0])
+                guard_fail("block range out of bounds", 0);
+}
+
+#define segment_free guard_free
+#define WORD_INDEX(offset) ((uint64_t) (offset) + 1)
+#define BLOCK_RANGE(segment, offset, count) \
+        guard_range(segment, offset, count)
+#else
+#define segment_free free
+#define WORD_INDEX(offset) ((offset) + 1)
+#define BLOCK_RANGE(segment, offset, count) ((void) 0)
+#endif
+
+/* Name: output_words
+ * Purpose: Write count words, each a byte, to stdout in one go
+ * Parameters: First word, number of words
+ * Returns: none
+ * Effects: Words above 255 are truncated, as with OUTPUT
+ */
+static void output_words(const uint32_t *words, uint32_t count)
+{
+        unsigned char bytes[4096];
+
+        while (count > 0) {
+                uint32_t chunk = count < sizeof(bytes) ? count : sizeof(bytes);
+                for (uint32_t i = 0; i < chunk; i++)
+                        bytes[i] = words[i];
+                fwrite(bytes, 1, chunk, stdout);
+
+                words += chunk;
+                count -= chunk;
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        /* um [-S] [-p] [-F socket] program.um: with -S opcodes 14 and 15
+           are invalid, as in the spec; with -p output goes to a pipe with
+           vmsplice (see splice_output.h); with -F, run up to the first
+           INPUT and then fork a warm copy per connection (see
+           fork_server.h) */
+        bool strict = false;
+        bool splice_output = false;
+        const char *serve_socket = NULL;
+        int arg = 1;
+        for (; arg < argc - 1; arg++) {
+                if (strcmp(argv[arg], "-S") == 0)
+                        strict = true;
+                else if (strcmp(argv[arg], "-p") == 0)
+                        splice_output = true;
+                else if (strcmp(argv[arg], "-F") == 0 && arg + 2 < argc)
+                        serve_socket = argv[++arg];
+                else
+                        exit(EXIT_FAILURE);
+        }
+        if (arg != argc - 1) exit(EXIT_FAILURE);
+
+        if (serve_socket != NULL)
+                Fork_server_prepare();
+
+        /* Made after the fork server has taken stdout, so that the
+           prelude and the children's sockets are written, not spliced */
+        Splice_output pages = NULL;
+        if (splice_output)
+                pages = Splice_output_new(STDOUT_FILENO, SPLICE_OUTPUT_BYTES);
+
+        const char *program_path = argv[argc - 1];
+
+        /**** LOAD PROGRAM ****/
+        /* Native-endian words, mapped from the program's .umx cache when
+           possible. The length sits right before the words, as in every
+           other segment. */
+        Umx_image program_image = Umx_load(program_path);
+
+        /* Segment zero while it is still the image, NULL once released */
+        uint32_t *image_segment = program_image.words - 1;
+        uint32_t *segment_zero = image_segment;
+
+#ifdef UM_GUARD
+        /* Segment zero needs a guard too, so it cannot stay the image */
+        uint32_t **guard_spine_start = guard_init();
+        segment_zero = guard_alloc(program_image.length);
+        Bulk_copy32(segment_zero + 1, program_image.words,
+                    program_image.length);
+        Umx_release(&program_image);
+        image_segment = NULL;
+#endif
         /**** END LOAD PROGRAM ****/
 
 
@@ -93,8 +955,12 @@ int main(int argc, char *argv[])
         uint32_t num_IDs = 0;
         uint32_t ID_arr_size = 1;
 
+#ifdef UM_GUARD
+        uint32_t **segments = guard_spine_start;
+#else
         uint32_t **segments = malloc(1 * sizeof(uint32_t *));
         assert(segments);
+#endif
         uint32_t segment_arr_size = 1;
         uint32_t total_seg_space = 1;
 
@@ -104,6 +970,16 @@ int main(int argc, char *argv[])
         int OP_CODE;
         (void) OP_CODE;
 
+#ifdef UM_PROFILE
+        uint64_t *profile_current = profile_start_generation(segment_zero);
+#endif
+#ifdef UM_HEATMAP
+        heat_map(0, segment_zero[0], HEAT_PROGRAM_PC);
+#endif
+#ifdef UM_SAMPLE
+        sample_start();
+#endif
+
         UM_instruction word;
         (void) word;
 
@@ -111,7 +987,20 @@ int main(int argc, char *argv[])
         while (true) {
                 segment_zero = segments[0];
 
-                word = segment_zero[program_counter + 1];
+#ifdef UM_GUARD
+                guard_pc = program_counter;
+#endif
+#ifdef UM_SAMPLE
+                sample_pc = program_counter;
+#endif
+                word = segment_zero[WORD_INDEX(program_counter)];
+
+#ifdef UM_PROFILE
+                if (profile_current)
+                        profile_current[program_counter]++;
+                else
+                        profile_untracked++;
+#endif
 
                 OP_CODE = word >> 28;
 
@@ -121,11 +1010,17 @@ int main(int argc, char *argv[])
                         program_counter++;
                 }
                 else if (OP_CODE == SEGMENTED_LOAD) {
-                        registers[(word >> 6) & 7] = segments[registers[(word >> 3) & 7]][registers[word & 7] + 1];
+#ifdef UM_HEATMAP
+                        heat_access(registers[(word >> 3) & 7], registers[word & 7], false);
+#endif
+                        registers[(word >> 6) & 7] = segments[registers[(word >> 3) & 7]][WORD_INDEX(registers[word & 7])];
                         program_counter++;
                 }
                 else if (OP_CODE == SEGMENTED_STORE) {
-                        segments[registers[(word >> 6) & 7]][registers[(word >> 3) & 7] + 1] = registers[word & 7];
+#ifdef UM_HEATMAP
+                        heat_access(registers[(word >> 6) & 7], registers[(word >> 3) & 7], true);
+#endif
+                        segments[registers[(word >> 6) & 7]][WORD_INDEX(registers[(word >> 3) & 7])] = registers[word & 7];
                         program_counter++;
                 }
                 else if (OP_CODE == BITWISE_NAND) {
@@ -145,16 +1040,35 @@ int main(int argc, char *argv[])
 
                                 uint32_t num_instructions = target_segment[0];
 
+#ifdef UM_GUARD
+                                uint32_t *deep_copy = guard_alloc(num_instructions);
+#else
                                 uint32_t *deep_copy = malloc((num_instructions + 1) * sizeof(uint32_t));
                                 assert(deep_copy);
+#endif
 
                                 uint32_t true_size = num_instructions + 1;
-                                for (size_t i = 0; i < true_size; i++)
-                                        deep_copy[i] = target_segment[i];
+                                Bulk_copy32(deep_copy, target_segment, true_size);
 
-                                free(segments[0]);
+#ifdef UM_SAMPLE
+                                sample_new_generation(segments[0]);
+#endif
+                                /* The first program may be a mapped image */
+                                if (segments[0] == image_segment) {
+                                        Umx_release(&program_image);
+                                        image_segment = NULL;
+                                }
+                                else
+                                        segment_free(segments[0]);
 
                                 segments[0] = deep_copy;
+
+#ifdef UM_PROFILE
+                                profile_current = profile_start_generation(deep_copy);
+#endif
+#ifdef UM_HEATMAP
+                                heat_generation++;
+#endif
                         }       
 
                         program_counter = registers[word & 7];
@@ -166,19 +1080,27 @@ int main(int argc, char *argv[])
                         program_counter++;
                 }
                 else if (OP_CODE == MAP_SEGMENT) {
+#ifdef UM_GUARD
+                        uint32_t *new_segment = guard_alloc(registers[word & 7]);
+#else
                         uint32_t *new_segment = calloc(registers[word & 7] + 1, sizeof(uint32_t));
                         assert(new_segment);
 
                         /* First elem stores the number of words */
                         new_segment[0] = registers[word & 7];
+#endif
                         
                         /* Case 1: If there are no unmapped IDs */
                         if (num_IDs == 0) {
                                 /* Check whether realloc is necessary for segments spine */
                                 if (total_seg_space == segment_arr_size) {
                                         uint32_t bigger_arr_size = segment_arr_size * 2;
+#ifdef UM_GUARD
+                                        segments = guard_grow_spine(bigger_arr_size);
+#else
                                         segments = realloc(segments, bigger_arr_size * sizeof(uint32_t *));
                                         assert(segments);
+#endif
                                         segment_arr_size = bigger_arr_size;
                                 }
 
@@ -196,16 +1118,28 @@ int main(int argc, char *argv[])
 
                                 /* Free data that has been there */
                                 uint32_t *to_unmap = segments[available_ID];
-                                free(to_unmap);
+                                segment_free(to_unmap);
 
                                 segments[available_ID] = new_segment;
 
                                 registers[(word >> 3) & 7] = available_ID;
                         }
 
+#ifdef UM_HEATMAP
+                        heat_map(registers[(word >> 3) & 7], new_segment[0], program_counter);
+#endif
+
                         program_counter++;
                 }
                 else if (OP_CODE == UNMAP_SEGMENT) {
+#ifdef UM_HEATMAP
+                        heat_unmap(registers[word & 7]);
+#endif
+#ifdef UM_GUARD
+                        /* Free now so that later accesses fault */
+                        guard_free(segments[registers[word & 7]]);
+                        segments[registers[word & 7]] = guard_sentinel;
+#endif
                         /* Add the new ID to the ID C-array */
                         if (num_IDs == ID_arr_size) {
                                 uint32_t bigger_arr_size = ID_arr_size * 2;
@@ -231,10 +1165,23 @@ int main(int argc, char *argv[])
                         program_counter++;
                 }
                 else if (OP_CODE == OUTPUT) {
-                        putchar(registers[word & 7]);
+                        if (pages != NULL)
+                                Splice_output_put(pages, registers[word & 7]);
+                        else
+                                putchar(registers[word & 7]);
                         program_counter++;
                 }
                 else if (OP_CODE == INPUT) {
+                        /* Only children come back, each with its client.
+                           Like stdout, the pages are not flushed for every
+                           INPUT, only before the prelude is taken. */
+                        if (serve_socket != NULL) {
+                                if (pages != NULL)
+                                        Splice_output_flush(pages);
+                                Fork_server_serve(serve_socket);
+                                serve_socket = NULL;
+                        }
+
                         int int_value = getchar();
 
                         if (int_value == EOF)
@@ -244,16 +1191,123 @@ int main(int argc, char *argv[])
 
                         program_counter++;
                 }
-                else if (OP_CODE == HALT)
+                else if (OP_CODE == HALT) {
+                        /* A program that never reads input serves its
+                           whole output */
+                        if (serve_socket != NULL) {
+                                if (pages != NULL)
+                                        Splice_output_flush(pages);
+                                Fork_server_serve(serve_socket);
+                        }
                         break;
+                }
+                else if (OP_CODE == BLOCK && !strict) {
+                        uint32_t *target = segments[registers[(word >> 6) & 7]];
+                        uint32_t offset = registers[(word >> 3) & 7];
+                        uint32_t count = registers[word & 7];
+                        uint32_t D_value = registers[(word >> 9) & 7];
+
+                        BLOCK_RANGE(target, offset, count);
+
+                        if (((word >> 25) & 7) == BLOCK_COPY) {
+                                uint32_t *source = segments[D_value];
+                                uint32_t source_offset = registers[(word >> 12) & 7];
+
+                                BLOCK_RANGE(source, source_offset, count);
+#ifdef UM_HEATMAP
+                                heat_range(D_value, source_offset, count, false);
+                                heat_range(registers[(word >> 6) & 7], offset,
+                                           count, true);
+#endif
+
+                                /* The ranges may overlap within a segment */
+                                memmove(target + WORD_INDEX(offset),
+                                        source + WORD_INDEX(source_offset),
+                                        (size_t) count * sizeof(uint32_t));
+                        }
+                        else if (((word >> 25) & 7) == BLOCK_FILL) {
+#ifdef UM_HEATMAP
+                                heat_range(registers[(word >> 6) & 7], offset,
+                                           count, true);
+#endif
+                                Bulk_fill32(target + WORD_INDEX(offset),
+                                            D_value, count);
+                        }
+                        else {
+#ifdef UM_GUARD
+                                guard_fail("invalid block operation", 0);
+#else
+                                fprintf(stderr, "um: invalid instruction %08"
+                                        PRIx32 " at program counter %08"
+                                        PRIx32 "\n", word, program_counter);
+                                abort();
+#endif
+                        }
+
+                        program_counter++;
+                }
+                else if (OP_CODE == OUTPUT_BLOCK && !strict) {
+                        uint32_t *source = segments[registers[(word >> 6) & 7]];
+                        uint32_t offset = registers[(word >> 3) & 7];
+                        uint32_t count = registers[word & 7];
+
+                        BLOCK_RANGE(source, offset, count);
+#ifdef UM_HEATMAP
+                        heat_range(registers[(word >> 6) & 7], offset, count,
+                                   false);
+#endif
+
+                        if (pages != NULL) {
+                                for (uint32_t i = 0; i < count; i++)
+                                        Splice_output_put(pages, source[WORD_INDEX(offset) + i]);
+                        }
+                        else {
+                                output_words(source + WORD_INDEX(offset), count);
+                        }
+                        program_counter++;
+                }
+#ifdef UM_GUARD
+                else
+                        guard_fail("invalid instruction", 0);
+#else
+                else {
+                        fprintf(stderr, "um: invalid instruction %08" PRIx32
+                                " at program counter %08" PRIx32 "\n",
+                                word, program_counter);
+                        abort();
+                }
+#endif
         }
 
+#ifdef UM_SAMPLE
+        /* Before the frees, the last generation's code is still needed */
+        sample_write(program_path, segments[0]);
+#endif
+
         /* Free the data */
-        for (size_t i = 0; i < total_seg_space; i++)
-                free(segments[i]);
+        if (segments[0] == image_segment)
+                Umx_release(&program_image);
+        else
+                segment_free(segments[0]);
+
+        for (size_t i = 1; i < total_seg_space; i++)
+                segment_free(segments[i]);
         
+#ifdef UM_GUARD
+        munmap(segments, GUARD_SPINE_BYTES);
+#else
         free(segments);
+#endif
         free(unmapped_IDs);
 
+#ifdef UM_PROFILE
+        profile_write(program_path);
+#endif
+#ifdef UM_HEATMAP
+        heat_write(program_path);
+#endif
+        if (pages != NULL)
+                Splice_output_free(&pages);
+
         return 0;
 }
\ No newline at end of file
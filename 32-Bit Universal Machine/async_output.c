@@ -0,0 +1,330 @@
+/* Name: async_output.c
+ * This module lets the UM hand OUTPUT bytes to a writer thread instead of
+ * blocking in write. The interpreter is the only producer and the writer
+ * thread the only consumer of a power-of-two ring, so the fast path is a
+ * store of the byte and a release of the tail index. The writer sleeps
+ * until a quarter of the ring is waiting and then writes all of it at
+ * once; the interpreter only looks at whether it must wake the writer
+ * when the tail crosses such a watermark, and on a flush (INPUT, exit) or
+ * a full ring, where it sleeps itself and records how long it waited.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "async_output.h"
+
+struct Async_output {
+        unsigned char *buffer;
+        size_t mask;            /* capacity - 1 */
+        size_t watermark;       /* bytes the writer waits for, a power of 2 */
+        int fd;
+
+        /* Written by the interpreter, read by the writer thread */
+        size_t tail;
+        bool stopping;
+
+        /* Written by the writer thread, read by the interpreter */
+        size_t head;
+        bool failed;            /* write to fd returned an error */
+
+        /* Sleep/wake handshake, each flag is only set by its own side */
+        int writer_sleeping;
+        int producer_sleeping;
+        pthread_mutex_t lock;
+        pthread_cond_t not_empty;
+        pthread_cond_t not_full;
+
+        pthread_t writer;
+
+        uint64_t stalls;        /* Waits because the ring was full */
+        uint64_t stall_ns;
+        uint64_t flushes;       /* Waits for pending output (INPUT, exit) */
+        uint64_t flush_ns;
+};
+
+static void *writer_main(void *closure);
+
+static uint64_t now_ns(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Name: Async_output_new
+ * Purpose: Allocate a ring and start the thread that drains it to fd
+ * Parameters: File descriptor to write to, ring capacity in bytes (rounded
+ *             up to a power of two)
+ * Returns: New ring
+ * Effects: Checked runtime error if allocation or thread creation fails
+ */
+Async_output Async_output_new(int fd, size_t capacity)
+{
+        assert(fd >= 0 && capacity > 0);
+
+        size_t size = 1;
+        while (size < capacity) {
+                size <<= 1;
+        }
+
+        Async_output out = calloc(1, sizeof(*out));
+        assert(out != NULL);
+
+        out->buffer = malloc(size);
+        assert(out->buffer != NULL);
+
+        out->mask = size - 1;
+        out->watermark = size >= 4 ? size / 4 : 1;
+        out->fd = fd;
+
+        pthread_mutex_init(&out->lock, NULL);
+        pthread_cond_init(&out->not_empty, NULL);
+        pthread_cond_init(&out->not_full, NULL);
+
+        int rc = pthread_create(&out->writer, NULL, writer_main, out);
+        assert(rc == 0);
+
+        return out;
+}
+
+/* Name: Async_output_free
+ * Purpose: Drain the ring, stop the writer thread and release the ring
+ * Parameters: Address of the ring
+ * Returns: none
+ * Effects: Checked runtime error if out or *out is null
+ */
+void Async_output_free(Async_output *out)
+{
+        assert(out != NULL && *out != NULL);
+
+        Async_output ring = *out;
+
+        Async_output_flush(ring);
+
+        pthread_mutex_lock(&ring->lock);
+        __atomic_store_n(&ring->stopping, true, __ATOMIC_SEQ_CST);
+        pthread_cond_signal(&ring->not_empty);
+        pthread_mutex_unlock(&ring->lock);
+
+        pthread_join(ring->writer, NULL);
+
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->not_empty);
+        pthread_cond_destroy(&ring->not_full);
+
+        free(ring->buffer);
+        free(ring);
+        *out = NULL;
+}
+
+/* Name: wake_writer
+ * Purpose: Wake the writer thread if it went to sleep waiting for output
+ * Parameters: Ring
+ * Returns: none
+ * Effects: The tail must already be published; the fence here and the
+ *          writer's sequentially consistent flag store and tail load
+ *          guarantee one side sees the other's update
+ */
+static void wake_writer(Async_output out)
+{
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&out->writer_sleeping, __ATOMIC_SEQ_CST)) {
+                pthread_mutex_lock(&out->lock);
+                pthread_cond_signal(&out->not_empty);
+                pthread_mutex_unlock(&out->lock);
+        }
+}
+
+/* Name: wait_for_head
+ * Purpose: Block the interpreter until the writer has consumed up to
+ *          target, timing the wait
+ * Parameters: Ring, head index that must be reached, counters to update
+ * Returns: none
+ * Effects: Adds one wait and its duration to the given counters
+ */
+static void wait_for_head(Async_output out, size_t target, uint64_t *waits,
+                          uint64_t *wait_ns)
+{
+        uint64_t start = now_ns();
+
+        /* The writer writes whatever is waiting while this flag is set,
+           however little, and checks it under the lock before sleeping */
+        pthread_mutex_lock(&out->lock);
+        __atomic_store_n(&out->producer_sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_cond_signal(&out->not_empty);
+        while ((ssize_t) (__atomic_load_n(&out->head, __ATOMIC_SEQ_CST) -
+                          target) < 0 &&
+               !__atomic_load_n(&out->failed, __ATOMIC_SEQ_CST)) {
+                pthread_cond_wait(&out->not_full, &out->lock);
+        }
+        __atomic_store_n(&out->producer_sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&out->lock);
+
+        (*waits)++;
+        *wait_ns += now_ns() - start;
+}
+
+/* Name: Async_output_put
+ * Purpose: Append one byte for the writer thread
+ * Parameters: Ring, byte
+ * Returns: none
+ * Effects: Stalls only while the ring is full. Wakes the writer each time
+ *          another watermark's worth of bytes is in. Bytes are dropped once
+ *          the writer has seen a write error, like output to a closed pipe.
+ */
+void Async_output_put(Async_output out, unsigned char byte)
+{
+        size_t tail = out->tail;
+
+        if (tail - __atomic_load_n(&out->head, __ATOMIC_ACQUIRE) > out->mask) {
+                wait_for_head(out, tail - out->mask, &out->stalls,
+                              &out->stall_ns);
+        }
+
+        if (__atomic_load_n(&out->failed, __ATOMIC_RELAXED)) {
+                return;
+        }
+
+        out->buffer[tail & out->mask] = byte;
+        __atomic_store_n(&out->tail, tail + 1, __ATOMIC_RELEASE);
+
+        if (((tail + 1) & (out->watermark - 1)) == 0) {
+                wake_writer(out);
+        }
+}
+
+/* Name: Async_output_flush
+ * Purpose: Wait until every byte put so far has been written to the fd,
+ *          e.g. before the UM blocks on INPUT
+ * Parameters: Ring
+ * Returns: none
+ * Effects: Counted separately from full-ring stalls
+ */
+void Async_output_flush(Async_output out)
+{
+        assert(out != NULL);
+
+        if (__atomic_load_n(&out->head, __ATOMIC_ACQUIRE) != out->tail) {
+                wait_for_head(out, out->tail, &out->flushes,
+                              &out->flush_ns);
+        }
+}
+
+/* Name: Async_output_report
+ * Purpose: Print how often and how long the interpreter waited on the ring
+ * Parameters: Ring, stream to print to
+ * Returns: none
+ * Effects: Checked runtime error if out or fp is null
+ */
+void Async_output_report(Async_output out, FILE *fp)
+{
+        assert(out != NULL && fp != NULL);
+
+        fprintf(fp, "async output: %" PRIu64 " full-ring stalls (%.3f ms), "
+                "%" PRIu64 " flushes (%.3f ms)\n",
+                out->stalls, out->stall_ns / 1e6,
+                out->flushes, out->flush_ns / 1e6);
+}
+
+/* Name: write_all
+ * Purpose: Write a contiguous run of the ring, retrying short writes
+ * Parameters: File descriptor, bytes, length
+ * Returns: false if the descriptor failed
+ * Effects: none
+ */
+static bool write_all(int fd, const unsigned char *bytes, size_t length)
+{
+        while (length > 0) {
+                ssize_t written = write(fd, bytes, length);
+
+                if (written < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return false;
+                }
+
+                bytes += written;
+                length -= written;
+        }
+
+        return true;
+}
+
+/* Whether the writer should write the pending bytes now rather than wait
+   for more: a watermark's worth, or any while the interpreter waits */
+static bool worth_writing(Async_output out, size_t pending)
+{
+        return pending >= out->watermark ||
+               (pending > 0 && __atomic_load_n(&out->producer_sleeping,
+                                               __ATOMIC_SEQ_CST));
+}
+
+/* Name: writer_main
+ * Purpose: Writer thread body, drains everything published so far with as
+ *          few writes as possible and sleeps until a watermark's worth is
+ *          waiting or the interpreter waits for it
+ * Parameters: The ring
+ * Returns: NULL
+ * Effects: Advances head and wakes a stalled interpreter
+ */
+static void *writer_main(void *closure)
+{
+        Async_output out = closure;
+        size_t head = out->head;
+
+        while (true) {
+                size_t tail = __atomic_load_n(&out->tail, __ATOMIC_ACQUIRE);
+
+                if (!worth_writing(out, tail - head)) {
+                        pthread_mutex_lock(&out->lock);
+                        __atomic_store_n(&out->writer_sleeping, 1,
+                                         __ATOMIC_SEQ_CST);
+                        while (!worth_writing(out, __atomic_load_n(&out->tail,
+                                                      __ATOMIC_SEQ_CST) - head)
+                               && !__atomic_load_n(&out->stopping,
+                                                   __ATOMIC_SEQ_CST)) {
+                                pthread_cond_wait(&out->not_empty,
+                                                  &out->lock);
+                        }
+                        __atomic_store_n(&out->writer_sleeping, 0,
+                                         __ATOMIC_SEQ_CST);
+                        pthread_mutex_unlock(&out->lock);
+
+                        if (__atomic_load_n(&out->stopping, __ATOMIC_SEQ_CST) &&
+                            __atomic_load_n(&out->tail, __ATOMIC_ACQUIRE) ==
+                            head) {
+                                return NULL; /* stopping and drained */
+                        }
+                        continue;
+                }
+
+                /* Write up to the wrap point, the rest on the next pass */
+                size_t start = head & out->mask;
+                size_t length = tail - head;
+                if (start + length > out->mask + 1) {
+                        length = out->mask + 1 - start;
+                }
+
+                if (!write_all(out->fd, out->buffer + start, length)) {
+                        __atomic_store_n(&out->failed, true, __ATOMIC_SEQ_CST);
+                }
+
+                head += length;
+                __atomic_store_n(&out->head, head, __ATOMIC_SEQ_CST);
+
+                if (__atomic_load_n(&out->producer_sleeping,
+                                    __ATOMIC_SEQ_CST)) {
+                        pthread_mutex_lock(&out->lock);
+                        pthread_cond_signal(&out->not_full);
+                        pthread_mutex_unlock(&out->lock);
+                }
+        }
+}
@@ -0,0 +1,25 @@
+/* Name: async_output.h
+ * Interface for async_output.c, a single-producer/single-consumer ring of
+ * output bytes drained to a file descriptor by a writer thread
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef ASYNC_OUTPUT_INCLUDED
+#define ASYNC_OUTPUT_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct Async_output *Async_output;
+
+Async_output Async_output_new(int fd, size_t capacity);
+void Async_output_free(Async_output *out);
+
+void Async_output_put(Async_output out, unsigned char byte);
+void Async_output_flush(Async_output out);
+
+void Async_output_report(Async_output out, FILE *fp);
+
+#endif
@@ -0,0 +1,211 @@
+/* Name: bulk_memory.c
+ * This module implements the bulk word copy and fill used when a segment
+ * is duplicated or created. There is an AVX2 kernel, an SSE2 kernel and a
+ * portable scalar fallback. The first call of either routine checks the
+ * CPU and points the routine at the widest kernel it supports, so later
+ * calls are one indirect jump.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include "bulk_memory.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BULK_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*copy_kernel)(uint32_t *, const uint32_t *, size_t);
+typedef void (*fill_kernel)(uint32_t *, uint32_t, size_t);
+
+static void resolve_copy(uint32_t *dst, const uint32_t *src, size_t count);
+static void resolve_fill(uint32_t *dst, uint32_t value, size_t count);
+
+static copy_kernel copy_words = resolve_copy;
+static fill_kernel fill_words = resolve_fill;
+static const char *kernel_name = NULL;
+
+/* Scalar kernels */
+
+static void copy_scalar(uint32_t *dst, const uint32_t *src, size_t count)
+{
+        for (size_t i = 0; i < count; i++) {
+                dst[i] = src[i];
+        }
+}
+
+static void fill_scalar(uint32_t *dst, uint32_t value, size_t count)
+{
+        for (size_t i = 0; i < count; i++) {
+                dst[i] = value;
+        }
+}
+
+#ifdef BULK_X86
+
+/* SSE2 kernels, four words per vector and four vectors per iteration */
+
+__attribute__((target("sse2")))
+static void copy_sse2(uint32_t *dst, const uint32_t *src, size_t count)
+{
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+                __m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+                __m128i b = _mm_loadu_si128((const __m128i *) (src + i + 4));
+                __m128i c = _mm_loadu_si128((const __m128i *) (src + i + 8));
+                __m128i d = _mm_loadu_si128((const __m128i *) (src + i + 12));
+                _mm_storeu_si128((__m128i *) (dst + i), a);
+                _mm_storeu_si128((__m128i *) (dst + i + 4), b);
+                _mm_storeu_si128((__m128i *) (dst + i + 8), c);
+                _mm_storeu_si128((__m128i *) (dst + i + 12), d);
+        }
+
+        for (; i + 4 <= count; i += 4) {
+                _mm_storeu_si128((__m128i *) (dst + i),
+                        _mm_loadu_si128((const __m128i *) (src + i)));
+        }
+
+        copy_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void fill_sse2(uint32_t *dst, uint32_t value, size_t count)
+{
+        __m128i v = _mm_set1_epi32((int) value);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+                _mm_storeu_si128((__m128i *) (dst + i), v);
+                _mm_storeu_si128((__m128i *) (dst + i + 4), v);
+                _mm_storeu_si128((__m128i *) (dst + i + 8), v);
+                _mm_storeu_si128((__m128i *) (dst + i + 12), v);
+        }
+
+        for (; i + 4 <= count; i += 4) {
+                _mm_storeu_si128((__m128i *) (dst + i), v);
+        }
+
+        fill_scalar(dst + i, value, count - i);
+}
+
+/* AVX2 kernels, eight words per vector and four vectors per iteration */
+
+__attribute__((target("avx2")))
+static void copy_avx2(uint32_t *dst, const uint32_t *src, size_t count)
+{
+        size_t i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+                __m256i a = _mm256_loadu_si256((const __m256i *) (src + i));
+                __m256i b = _mm256_loadu_si256((const __m256i *)
+                                               (src + i + 8));
+                __m256i c = _mm256_loadu_si256((const __m256i *)
+                                               (src + i + 16));
+                __m256i d = _mm256_loadu_si256((const __m256i *)
+                                               (src + i + 24));
+                _mm256_storeu_si256((__m256i *) (dst + i), a);
+                _mm256_storeu_si256((__m256i *) (dst + i + 8), b);
+                _mm256_storeu_si256((__m256i *) (dst + i + 16), c);
+                _mm256_storeu_si256((__m256i *) (dst + i + 24), d);
+        }
+
+        for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_si256((__m256i *) (dst + i),
+                        _mm256_loadu_si256((const __m256i *) (src + i)));
+        }
+
+        copy_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void fill_avx2(uint32_t *dst, uint32_t value, size_t count)
+{
+        __m256i v = _mm256_set1_epi32((int) value);
+        size_t i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+                _mm256_storeu_si256((__m256i *) (dst + i), v);
+                _mm256_storeu_si256((__m256i *) (dst + i + 8), v);
+                _mm256_storeu_si256((__m256i *) (dst + i + 16), v);
+                _mm256_storeu_si256((__m256i *) (dst + i + 24), v);
+        }
+
+        for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_si256((__m256i *) (dst + i), v);
+        }
+
+        fill_scalar(dst + i, value, count - i);
+}
+
+#endif
+
+/* Name: choose_kernels
+ * Purpose: Point copy_words and fill_words at the best kernels this CPU
+ *          supports
+ * Parameters: none
+ * Returns: none
+ * Effects: Sets the kernel pointers and kernel_name
+ */
+static void choose_kernels(void)
+{
+        copy_words = copy_scalar;
+        fill_words = fill_scalar;
+        kernel_name = "scalar";
+
+#ifdef BULK_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) {
+                copy_words = copy_avx2;
+                fill_words = fill_avx2;
+                kernel_name = "avx2";
+        } else if (__builtin_cpu_supports("sse2")) {
+                copy_words = copy_sse2;
+                fill_words = fill_sse2;
+                kernel_name = "sse2";
+        }
+#endif
+}
+
+static void resolve_copy(uint32_t *dst, const uint32_t *src, size_t count)
+{
+        choose_kernels();
+        copy_words(dst, src, count);
+}
+
+static void resolve_fill(uint32_t *dst, uint32_t value, size_t count)
+{
+        choose_kernels();
+        fill_words(dst, value, count);
+}
+
+/* Name: Bulk_copy32
+ * Purpose: Copy count words from src to dst with the chosen kernel
+ * Parameters: Destination, source, number of words
+ * Returns: none
+ * Effects: The ranges must not overlap
+ */
+void Bulk_copy32(uint32_t *dst, const uint32_t *src, size_t count)
+{
+        copy_words(dst, src, count);
+}
+
+/* Name: Bulk_fill32
+ * Purpose: Set count words at dst to value with the chosen kernel
+ * Parameters: Destination, value, number of words
+ * Returns: none
+ * Effects: none
+ */
+void Bulk_fill32(uint32_t *dst, uint32_t value, size_t count)
+{
+        fill_words(dst, value, count);
+}
+
+const char *Bulk_memory_kernel(void)
+{
+        if (kernel_name == NULL) {
+                choose_kernels();
+        }
+        return kernel_name;
+}
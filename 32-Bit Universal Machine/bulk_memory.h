@@ -0,0 +1,23 @@
+/* Name: bulk_memory.h
+ * Interface for bulk_memory.c, word copy and fill kernels for the large
+ * segment operations (LOAD_PROGRAM duplicates, newly mapped segments)
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef BULK_MEMORY_INCLUDED
+#define BULK_MEMORY_INCLUDED
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Copy count 32-bit words from src to dst (the ranges may not overlap) */
+void Bulk_copy32(uint32_t *dst, const uint32_t *src, size_t count);
+
+/* Set count 32-bit words at dst to value */
+void Bulk_fill32(uint32_t *dst, uint32_t value, size_t count);
+
+/* Name of the kernel chosen for this CPU: "avx2", "sse2" or "scalar" */
+const char *Bulk_memory_kernel(void);
+
+#endif
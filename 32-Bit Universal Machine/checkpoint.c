@@ -0,0 +1,398 @@
+/* Name: checkpoint.c
+ * This module saves a running universal machine in a chain of files and
+ * rebuilds it from them (see checkpoint.h). The segments' dirty bits,
+ * which universal_machine.c sets on every MAP, UNMAP and store, decide
+ * what an increment holds, so a program with a large but quiet heap writes
+ * little more than the segments its loop touches.
+ *
+ * Each file is a header, the free-ID list, and one record per saved
+ * segment: its ID, whether it is mapped, its length and (when mapped) its
+ * words, all in native byte order. Files are written under a temporary
+ * name and renamed into place, so a crash mid-write leaves the previous
+ * chain intact.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC 0x31434d55u    /* "UMC1" in little-endian order */
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+
+typedef enum checkpoint_kind { CHECKPOINT_BASE, CHECKPOINT_INCREMENT }
+        checkpoint_kind;
+
+typedef struct checkpoint_header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t kind;
+        uint64_t chain;         /* Same in every file of one chain */
+        uint64_t sequence;      /* An increment's number; for a base, the
+                                   last increment it replaces */
+        uint32_t registers[8];
+        uint32_t program_counter;
+        uint32_t segment_count; /* IDs in use, mapped or not */
+        uint32_t free_count;
+        uint32_t record_count;
+} checkpoint_header;
+
+typedef struct segment_record {
+        uint32_t ID;
+        uint32_t valid;
+        uint32_t length;
+} segment_record;
+
+struct Checkpoint_T {
+        char *prefix;
+        unsigned max_increments;
+        bool started;           /* A base has been written */
+        uint64_t chain;
+        uint64_t base_sequence; /* Increments up to here are merged */
+        uint64_t sequence;      /* Last increment written */
+};
+
+/* Name: checkpoint_path
+ * Purpose: Name one file of a chain
+ * Parameters: Buffer and its size, prefix, increment number (0 for base)
+ * Returns: none
+ * Effects: Checked runtime error if the name does not fit
+ */
+static void checkpoint_path(char *path, size_t size, const char *prefix,
+                            uint64_t sequence)
+{
+        int length;
+
+        if (sequence == 0) {
+                length = snprintf(path, size, "%s.ckpt", prefix);
+        }
+        else {
+                length = snprintf(path, size, "%s.ckpt.%llu", prefix,
+                                  (unsigned long long) sequence);
+        }
+
+        assert(length >= 0 && (size_t) length < size);
+}
+
+/* Name: Checkpoint_new
+ * Purpose: Create a checkpoint writer
+ * Parameters: Path prefix of the files, increments between bases (at
+ *             least 1)
+ * Returns: Writer, whose first checkpoint starts a new chain
+ * Effects: Checked runtime error if allocation fails
+ */
+Checkpoint_T Checkpoint_new(const char *prefix, unsigned max_increments)
+{
+        assert(prefix != NULL && max_increments > 0);
+
+        Checkpoint_T writer = calloc(1, sizeof(*writer));
+        assert(writer != NULL);
+
+        writer->prefix = malloc(strlen(prefix) + 1);
+        assert(writer->prefix != NULL);
+        strcpy(writer->prefix, prefix);
+        writer->max_increments = max_increments;
+
+        return writer;
+}
+
+void Checkpoint_free(Checkpoint_T *writer)
+{
+        assert(writer != NULL && *writer != NULL);
+
+        free((*writer)->prefix);
+        free(*writer);
+        *writer = NULL;
+}
+
+static void write_exact(FILE *fp, const void *data, size_t bytes)
+{
+        size_t written = fwrite(data, 1, bytes, fp);
+        assert(written == bytes);
+}
+
+static void read_exact(FILE *fp, void *data, size_t bytes)
+{
+        size_t got = fread(data, 1, bytes, fp);
+        assert(got == bytes);
+}
+
+/* Name: new_chain_id
+ * Purpose: Pick an identifier that no earlier chain for the prefix used
+ * Parameters: none
+ * Returns: Identifier made from the clock and process ID
+ * Effects: none
+ */
+static uint64_t new_chain_id(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        return ((uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec) ^
+               ((uint64_t) getpid() << 48);
+}
+
+/* Name: Checkpoint_write
+ * Purpose: Save the machine as the next file of the writer's chain
+ * Parameters: Writer, machine
+ * Returns: Number of bytes written
+ * Effects: Writes a base (every segment) for the first checkpoint and once
+ *          max_increments increments follow the last base, and removes the
+ *          increments a new base replaces; otherwise writes an increment
+ *          with the dirty segments only. Clears every dirty bit. Checked
+ *          runtime error if the file cannot be written.
+ */
+size_t Checkpoint_write(Checkpoint_T writer, universal_machine UM)
+{
+        assert(writer != NULL && UM != NULL);
+
+        bool base = !writer->started ||
+                    writer->sequence - writer->base_sequence >=
+                    writer->max_increments;
+
+        if (!writer->started) {
+                writer->started = true;
+                writer->chain = new_chain_id();
+                writer->sequence = 0;
+        }
+
+        uint64_t merged_from = writer->base_sequence;
+        uint32_t segment_count = Seq_length(UM->segments);
+
+        checkpoint_header header;
+        memset(&header, 0, sizeof(header));
+        header.magic = CHECKPOINT_MAGIC;
+        header.version = CHECKPOINT_VERSION;
+        header.byte_order = CHECKPOINT_BYTE_ORDER;
+        header.kind = base ? CHECKPOINT_BASE : CHECKPOINT_INCREMENT;
+        header.chain = writer->chain;
+        header.sequence = base ? writer->sequence : writer->sequence + 1;
+        memcpy(header.registers, UM->registers, sizeof(header.registers));
+        header.program_counter = UM->program_counter;
+        header.segment_count = segment_count;
+        header.free_count = Seq32_length(UM->unmapped_IDs);
+
+        for (uint32_t ID = 0; ID < segment_count; ID++) {
+                segment seg = Seq_get(UM->segments, ID);
+                if (base || seg->dirty) {
+                        header.record_count++;
+                }
+        }
+
+        char path[4096], temp_path[4096 + 32];
+        checkpoint_path(path, sizeof(path), writer->prefix,
+                        base ? 0 : header.sequence);
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", path,
+                 (long) getpid());
+
+        FILE *fp = fopen(temp_path, "wb");
+        assert(fp != NULL);
+
+        write_exact(fp, &header, sizeof(header));
+        size_t bytes = sizeof(header);
+
+        for (uint32_t i = 0; i < header.free_count; i++) {
+                uint32_t ID = Seq32_get(UM->unmapped_IDs, i);
+                write_exact(fp, &ID, sizeof(ID));
+        }
+        bytes += (size_t) header.free_count * sizeof(uint32_t);
+
+        for (uint32_t ID = 0; ID < segment_count; ID++) {
+                segment seg = Seq_get(UM->segments, ID);
+                if (!base && !seg->dirty) {
+                        continue;
+                }
+
+                segment_record record = { ID, seg->valid, seg->valid ?
+                                                          seg->length : 0 };
+                write_exact(fp, &record, sizeof(record));
+                write_exact(fp, seg->words, (size_t) record.length *
+                                            sizeof(uint32_t));
+                bytes += sizeof(record) + (size_t) record.length *
+                                          sizeof(uint32_t);
+                seg->dirty = false;
+        }
+
+        int closed = fclose(fp);
+        assert(closed == 0);
+        int renamed = rename(temp_path, path);
+        assert(renamed == 0);
+
+        if (base) {
+                /* The new base holds everything they did */
+                for (uint64_t s = merged_from + 1; s <= writer->sequence;
+                     s++) {
+                        checkpoint_path(path, sizeof(path), writer->prefix,
+                                        s);
+                        unlink(path);
+                }
+                writer->base_sequence = writer->sequence;
+        }
+        else {
+                writer->sequence = header.sequence;
+        }
+
+        return bytes;
+}
+
+/* Name: read_header
+ * Purpose: Read and check the header of a chain file
+ * Parameters: Open file, header to fill in
+ * Returns: none
+ * Effects: Checked runtime error if it is not a checkpoint written on a
+ *          machine with this byte order
+ */
+static void read_header(FILE *fp, checkpoint_header *header)
+{
+        read_exact(fp, header, sizeof(*header));
+
+        assert(header->magic == CHECKPOINT_MAGIC &&
+               header->version == CHECKPOINT_VERSION &&
+               header->byte_order == CHECKPOINT_BYTE_ORDER);
+}
+
+/* Name: read_words
+ * Purpose: Read a mapped segment's words into a block the UM can own
+ * Parameters: Open file, number of words
+ * Returns: Malloced words, one spare word long like map_segment's
+ * Effects: Checked runtime error if allocation or reading fails
+ */
+static UM_instruction *read_words(FILE *fp, uint32_t length)
+{
+        UM_instruction *words = malloc(((size_t) length + 1) *
+                                       sizeof(UM_instruction));
+        assert(words != NULL);
+        read_exact(fp, words, (size_t) length * sizeof(UM_instruction));
+
+        return words;
+}
+
+/* Name: apply_record
+ * Purpose: Replace one segment of a machine with a saved record
+ * Parameters: Machine, record, open file positioned at its words
+ * Returns: none
+ * Effects: IDs up to the record's are added unmapped if the machine does
+ *          not have them yet
+ */
+static void apply_record(universal_machine UM, segment_record record,
+                         FILE *fp)
+{
+        if (record.ID == 0) {
+                assert(record.valid);
+                replace_segment_zero(UM, read_words(fp, record.length),
+                                     record.length);
+                return;
+        }
+
+        while ((uint32_t) Seq_length(UM->segments) <= record.ID) {
+                segment seg = calloc(1, sizeof(*seg));
+                assert(seg != NULL);
+                Seq_addhi(UM->segments, seg);
+        }
+
+        segment seg = Seq_get(UM->segments, record.ID);
+        if (seg->valid) {
+                free(seg->words);
+        }
+
+        seg->valid = record.valid;
+        seg->length = record.length;
+        seg->words = record.valid ? read_words(fp, record.length) : NULL;
+}
+
+/* Name: apply_file
+ * Purpose: Bring a machine to the state one chain file saved
+ * Parameters: Machine, open file positioned after its header, header
+ * Returns: none
+ * Effects: Checked runtime error if the file is truncated or inconsistent
+ */
+static void apply_file(universal_machine UM, FILE *fp,
+                       const checkpoint_header *header)
+{
+        memcpy(UM->registers, header->registers, sizeof(UM->registers));
+        UM->program_counter = header->program_counter;
+
+        while (Seq32_length(UM->unmapped_IDs) > 0) {
+                Seq32_remhi(UM->unmapped_IDs);
+        }
+        for (uint32_t i = 0; i < header->free_count; i++) {
+                uint32_t ID;
+                read_exact(fp, &ID, sizeof(ID));
+                Seq32_addhi(UM->unmapped_IDs, ID);
+        }
+
+        for (uint32_t i = 0; i < header->record_count; i++) {
+                segment_record record;
+                read_exact(fp, &record, sizeof(record));
+                assert(record.ID < header->segment_count);
+                apply_record(UM, record, fp);
+        }
+
+        assert((uint32_t) Seq_length(UM->segments) == header->segment_count);
+}
+
+/* Name: Checkpoint_restore
+ * Purpose: Rebuild a machine from the chain for prefix
+ * Parameters: Path prefix of the files
+ * Returns: Machine with the registers, program counter, segments and
+ *          free-ID list of the last file in the chain, or NULL if there is
+ *          no base file
+ * Effects: Increments are applied in order until one is missing or belongs
+ *          to another chain. Checked runtime error if a file is damaged.
+ */
+universal_machine Checkpoint_restore(const char *prefix)
+{
+        assert(prefix != NULL);
+
+        char path[4096];
+        checkpoint_path(path, sizeof(path), prefix, 0);
+
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+                return NULL;
+        }
+
+        checkpoint_header base;
+        read_header(fp, &base);
+        assert(base.kind == CHECKPOINT_BASE && base.record_count > 0);
+
+        /* new_UM needs a segment zero, the base's first record replaces it */
+        UM_instruction *placeholder = malloc(sizeof(UM_instruction));
+        assert(placeholder != NULL);
+        universal_machine UM = new_UM(placeholder, 0);
+
+        apply_file(UM, fp, &base);
+        fclose(fp);
+
+        for (uint64_t s = base.sequence + 1; ; s++) {
+                checkpoint_path(path, sizeof(path), prefix, s);
+                fp = fopen(path, "rb");
+                if (fp == NULL) {
+                        break;
+                }
+
+                checkpoint_header header;
+                read_header(fp, &header);
+                if (header.chain != base.chain || header.sequence != s ||
+                    header.kind != CHECKPOINT_INCREMENT) {
+                        fclose(fp);
+                        break;
+                }
+
+                apply_file(UM, fp, &header);
+                fclose(fp);
+        }
+
+        /* The machine now matches the chain on disk */
+        for (int ID = 0; ID < Seq_length(UM->segments); ID++) {
+                segment seg = Seq_get(UM->segments, ID);
+                seg->dirty = false;
+        }
+
+        return UM;
+}
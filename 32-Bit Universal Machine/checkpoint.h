@@ -0,0 +1,41 @@
+/* Name: checkpoint.h
+ * Interface for checkpoint.c, incremental checkpoints of a running UM.
+ *
+ * A chain of checkpoints for prefix P is a base file P.ckpt holding every
+ * segment, followed by increments P.ckpt.1, P.ckpt.2, ... each holding only
+ * the segments mapped, unmapped or stored into since the file before it.
+ * Every file also holds the registers, program counter and free-ID list.
+ * Once a chain reaches its limit the next checkpoint is a new base, which
+ * is the whole chain merged, and the increments it replaces are removed.
+ *
+ * Input the program already read and output it already wrote are not part
+ * of a checkpoint; a restored program continues with whatever input the
+ * new process is given. So a caller must write out all buffered output
+ * (stdio, the async ring, splice pages) before Checkpoint_write: output
+ * still buffered when the process dies after a checkpoint is lost, since
+ * a run resumed from it starts after that output.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef CHECKPOINT_INCLUDED
+#define CHECKPOINT_INCLUDED
+
+#include "universal_machine.h"
+
+typedef struct Checkpoint_T *Checkpoint_T;
+
+/* A writer that starts a new chain for prefix at its first checkpoint and
+ * writes a new base after every max_increments increments */
+Checkpoint_T Checkpoint_new(const char *prefix, unsigned max_increments);
+void Checkpoint_free(Checkpoint_T *writer);
+
+/* Save the machine's state and clear its segments' dirty bits. Returns the
+ * number of bytes written. */
+size_t Checkpoint_write(Checkpoint_T writer, universal_machine UM);
+
+/* Rebuild the machine saved by the chain for prefix, or return NULL if
+ * prefix has no base file */
+universal_machine Checkpoint_restore(const char *prefix);
+
+#endif
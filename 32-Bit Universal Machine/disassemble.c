@@ -0,0 +1,585 @@
+/* Name: disassemble.c
+ * This module decodes UM program images for inspection. It knows how the
+ * 32-bit words are laid out, prints them as three-register or LOAD_VALUE
+ * mnemonics, and finds basic blocks by tracking which register values are
+ * statically known so that LOAD_PROGRAM targets can be resolved.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "disassemble.h"
+#include "bitpack.h"
+
+/* A register is either unknown or one of up to DIS_MAX_TARGETS values, which
+   is enough to follow the usual "cmov then goto" conditional branch */
+typedef struct value_set {
+        int count; /* -1 means unknown */
+        uint32_t values[DIS_MAX_TARGETS];
+} value_set;
+
+static const char *opcode_names[16] = {
+        "CMOV", "SLOAD", "SSTORE", "ADD", "MUL", "DIV", "NAND", "HALT",
+        "MAP", "UNMAP", "OUT", "IN", "LOADP", "LV", "BLOCK", "BOUT"
+};
+
+/* Operations of opcode 14 by bits 25-27 (see instruction_set.h) */
+static const char *block_names[8] = {
+        "BCOPY", "BFILL", "BLOCK", "BLOCK", "BLOCK", "BLOCK", "BLOCK", "BLOCK"
+};
+
+/* Name: Dis_read_image
+ * Purpose: Read a big-endian UM program image into an array of words
+ * Parameters: File pointer, address to store the number of words read
+ * Returns: Malloced array of words which the caller must free
+ * Effects: Checked runtime error if fp or length is null or malloc fails.
+ *          A trailing partial word is padded with zero bytes.
+ */
+uint32_t *Dis_read_image(FILE *fp, uint32_t *length)
+{
+        assert(fp != NULL && length != NULL);
+
+        uint32_t capacity = 1024;
+        uint32_t *words = malloc(capacity * sizeof(uint32_t));
+        assert(words != NULL);
+
+        uint32_t num_words = 0;
+        int byte = fgetc(fp);
+
+        while (byte != EOF) {
+                uint32_t word = 0;
+
+                for (int i = 3; i >= 0; i--) {
+                        if (byte != EOF) {
+                                word = Bitpack_newu(word, 8, i * 8, byte);
+                                byte = fgetc(fp);
+                        }
+                }
+
+                if (num_words == capacity) {
+                        capacity *= 2;
+                        words = realloc(words, capacity * sizeof(uint32_t));
+                        assert(words != NULL);
+                }
+
+                words[num_words++] = word;
+        }
+
+        *length = num_words;
+        return words;
+}
+
+/* Name: Dis_opcode_name
+ * Purpose: Name the operation encoded in the top four bits of a word
+ * Parameters: UM word
+ * Returns: Constant string such as "ADD" or "LV"
+ * Effects: none
+ */
+const char *Dis_opcode_name(uint32_t word)
+{
+        unsigned op = Bitpack_getu(word, 4, 28);
+
+        if (op == 14) {
+                return block_names[Bitpack_getu(word, 3, 25)];
+        }
+
+        return opcode_names[op];
+}
+
+/* Name: Dis_format
+ * Purpose: Write the assembler form of a word, e.g. "ADD r1, r2, r3"
+ * Parameters: UM word, output buffer and its size
+ * Returns: none
+ * Effects: Checked runtime error if buffer is null
+ */
+void Dis_format(uint32_t word, char *buffer, size_t size)
+{
+        assert(buffer != NULL);
+
+        unsigned op = Bitpack_getu(word, 4, 28);
+
+        if (op == 13) {
+                snprintf(buffer, size, "%-6s r%u, %u", opcode_names[op],
+                         (unsigned) Bitpack_getu(word, 3, 25),
+                         (unsigned) Bitpack_getu(word, 25, 0));
+        } else if (op == 14 && Bitpack_getu(word, 3, 25) == 0) {
+                snprintf(buffer, size, "%-6s r%u, r%u, r%u, r%u, r%u",
+                         Dis_opcode_name(word),
+                         (unsigned) Bitpack_getu(word, 3, 6),
+                         (unsigned) Bitpack_getu(word, 3, 3),
+                         (unsigned) Bitpack_getu(word, 3, 0),
+                         (unsigned) Bitpack_getu(word, 3, 9),
+                         (unsigned) Bitpack_getu(word, 3, 12));
+        } else if (op == 14) {
+                snprintf(buffer, size, "%-6s r%u, r%u, r%u, r%u",
+                         Dis_opcode_name(word),
+                         (unsigned) Bitpack_getu(word, 3, 6),
+                         (unsigned) Bitpack_getu(word, 3, 3),
+                         (unsigned) Bitpack_getu(word, 3, 0),
+                         (unsigned) Bitpack_getu(word, 3, 9));
+        } else {
+                snprintf(buffer, size, "%-6s r%u, r%u, r%u", opcode_names[op],
+                         (unsigned) Bitpack_getu(word, 3, 6),
+                         (unsigned) Bitpack_getu(word, 3, 3),
+                         (unsigned) Bitpack_getu(word, 3, 0));
+        }
+}
+
+/* Name: Dis_describe
+ * Purpose: Write the semantics of a word in the notation of the UM spec,
+ *          e.g. "r1 := r2 + r3"
+ * Parameters: UM word, output buffer and its size
+ * Returns: none
+ * Effects: Checked runtime error if buffer is null
+ */
+void Dis_describe(uint32_t word, char *buffer, size_t size)
+{
+        assert(buffer != NULL);
+
+        unsigned op = Bitpack_getu(word, 4, 28);
+        unsigned A = Bitpack_getu(word, 3, 6);
+        unsigned B = Bitpack_getu(word, 3, 3);
+        unsigned C = Bitpack_getu(word, 3, 0);
+
+        switch (op) {
+                case 0:
+                        snprintf(buffer, size, "if (r%u != 0) r%u := r%u",
+                                 C, A, B);
+                        break;
+                case 1:
+                        snprintf(buffer, size, "r%u := m[r%u][r%u]", A, B, C);
+                        break;
+                case 2:
+                        snprintf(buffer, size, "m[r%u][r%u] := r%u", A, B, C);
+                        break;
+                case 3:
+                        snprintf(buffer, size, "r%u := r%u + r%u", A, B, C);
+                        break;
+                case 4:
+                        snprintf(buffer, size, "r%u := r%u * r%u", A, B, C);
+                        break;
+                case 5:
+                        snprintf(buffer, size, "r%u := r%u / r%u", A, B, C);
+                        break;
+                case 6:
+                        snprintf(buffer, size, "r%u := ~(r%u & r%u)",
+                                 A, B, C);
+                        break;
+                case 7:
+                        snprintf(buffer, size, "halt");
+                        break;
+                case 8:
+                        snprintf(buffer, size, "r%u := map segment (r%u words)",
+                                 B, C);
+                        break;
+                case 9:
+                        snprintf(buffer, size, "unmap m[r%u]", C);
+                        break;
+                case 10:
+                        snprintf(buffer, size, "output r%u", C);
+                        break;
+                case 11:
+                        snprintf(buffer, size, "r%u := input()", C);
+                        break;
+                case 12:
+                        snprintf(buffer, size, "goto m[r%u][r%u]", B, C);
+                        break;
+                case 13:
+                        snprintf(buffer, size, "r%u := %u",
+                                 (unsigned) Bitpack_getu(word, 3, 25),
+                                 (unsigned) Bitpack_getu(word, 25, 0));
+                        break;
+                case 14:
+                        if (Bitpack_getu(word, 3, 25) == 0) {
+                                snprintf(buffer, size, "m[r%u][r%u..] := "
+                                         "m[r%u][r%u..] (r%u words)", A, B,
+                                         (unsigned) Bitpack_getu(word, 3, 9),
+                                         (unsigned) Bitpack_getu(word, 3, 12),
+                                         C);
+                        } else if (Bitpack_getu(word, 3, 25) == 1) {
+                                snprintf(buffer, size, "m[r%u][r%u..] := r%u "
+                                         "(r%u words)", A, B,
+                                         (unsigned) Bitpack_getu(word, 3, 9),
+                                         C);
+                        } else {
+                                snprintf(buffer, size, "invalid block "
+                                         "operation %u",
+                                         (unsigned) Bitpack_getu(word, 3, 25));
+                        }
+                        break;
+                case 15:
+                        snprintf(buffer, size, "output m[r%u][r%u..] "
+                                 "(r%u words)", A, B, C);
+                        break;
+                default:
+                        snprintf(buffer, size, "invalid opcode %u", op);
+                        break;
+        }
+}
+
+/* Value set helpers used by the constant tracking in Dis_find_blocks */
+
+static void forget_all(value_set registers[8])
+{
+        for (int i = 0; i < 8; i++) {
+                registers[i].count = -1;
+        }
+}
+
+static void set_single(value_set *target, uint32_t value)
+{
+        target->count = 1;
+        target->values[0] = value;
+}
+
+static bool contains(const value_set *set, uint32_t value)
+{
+        for (int i = 0; i < set->count; i++) {
+                if (set->values[i] == value) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+static void add_value(value_set *set, uint32_t value)
+{
+        if (set->count < 0 || contains(set, value)) {
+                return;
+        }
+
+        if (set->count == DIS_MAX_TARGETS) {
+                set->count = -1;
+        } else {
+                set->values[set->count++] = value;
+        }
+}
+
+/* Name: combine
+ * Purpose: Apply a binary arithmetic opcode to every pair of known values
+ * Parameters: Opcode, operand sets, and the destination set
+ * Returns: none
+ * Effects: Result is unknown if either operand is unknown, if there are too
+ *          many combinations, or if a division by zero could occur
+ */
+static void combine(unsigned op, value_set B, value_set C, value_set *result)
+{
+        value_set out = { .count = 0 };
+
+        if (B.count < 0 || C.count < 0) {
+                result->count = -1;
+                return;
+        }
+
+        for (int i = 0; i < B.count && out.count >= 0; i++) {
+                for (int j = 0; j < C.count && out.count >= 0; j++) {
+                        uint32_t x = B.values[i];
+                        uint32_t y = C.values[j];
+
+                        if (op == 3) {
+                                add_value(&out, x + y);
+                        } else if (op == 4) {
+                                add_value(&out, x * y);
+                        } else if (op == 5 && y != 0) {
+                                add_value(&out, x / y);
+                        } else if (op == 6) {
+                                add_value(&out, ~(x & y));
+                        } else {
+                                out.count = -1;
+                        }
+                }
+        }
+
+        *result = out;
+}
+
+/* Name: simulate
+ * Purpose: Update the known register values for one straight-line word
+ * Parameters: UM word, register value sets
+ * Returns: none
+ * Effects: Registers written from memory or input become unknown
+ */
+static void simulate(uint32_t word, value_set registers[8])
+{
+        unsigned op = Bitpack_getu(word, 4, 28);
+        unsigned A = Bitpack_getu(word, 3, 6);
+        unsigned B = Bitpack_getu(word, 3, 3);
+        unsigned C = Bitpack_getu(word, 3, 0);
+
+        switch (op) {
+                case 0:
+                        if (registers[C].count == 1 &&
+                            registers[C].values[0] == 0) {
+                                break;
+                        }
+                        if (registers[C].count > 0 &&
+                            !contains(&registers[C], 0)) {
+                                registers[A] = registers[B];
+                                break;
+                        }
+                        /* Either value may survive the conditional move */
+                        if (registers[B].count < 0) {
+                                registers[A].count = -1;
+                        }
+                        for (int i = 0; i < registers[B].count; i++) {
+                                add_value(&registers[A],
+                                          registers[B].values[i]);
+                        }
+                        break;
+                case 1:
+                        registers[A].count = -1;
+                        break;
+                case 3: case 4: case 5: case 6:
+                        combine(op, registers[B], registers[C],
+                                &registers[A]);
+                        break;
+                case 8:
+                        registers[B].count = -1;
+                        break;
+                case 11:
+                        registers[C].count = -1;
+                        break;
+                case 13:
+                        set_single(&registers[Bitpack_getu(word, 3, 25)],
+                                   Bitpack_getu(word, 25, 0));
+                        break;
+                default:
+                        break;
+        }
+}
+
+/* Name: classify_jump
+ * Purpose: Fill in the exit kind and targets of a block ending in
+ *          LOAD_PROGRAM from the registers known at that point
+ * Parameters: LOAD_PROGRAM word, register value sets, block to update
+ * Returns: none
+ * Effects: none
+ */
+static void classify_jump(uint32_t word, value_set registers[8],
+                          Dis_block *block)
+{
+        value_set segment_ID = registers[Bitpack_getu(word, 3, 3)];
+        value_set target = registers[Bitpack_getu(word, 3, 0)];
+
+        block->num_targets = 0;
+
+        if (segment_ID.count == 1 && segment_ID.values[0] == 0) {
+                block->exit = DIS_JUMP;
+        } else if (segment_ID.count > 0 && !contains(&segment_ID, 0)) {
+                block->exit = DIS_FAR_JUMP;
+        } else {
+                block->exit = DIS_UNKNOWN_JUMP;
+                return;
+        }
+
+        if (target.count < 0) {
+                if (block->exit == DIS_JUMP) {
+                        block->exit = DIS_UNKNOWN_JUMP;
+                }
+                return;
+        }
+
+        block->num_targets = target.count;
+        for (int i = 0; i < target.count; i++) {
+                block->targets[i] = target.values[i];
+        }
+}
+
+/* Name: join
+ * Purpose: Merge the registers flowing out of one block into the entry
+ *          state of a successor
+ * Parameters: Successor entry registers, whether they have been reached
+ *             yet, registers to merge in
+ * Returns: true if the entry state changed
+ * Effects: none
+ */
+static bool join(value_set entry[8], bool *reached, value_set incoming[8])
+{
+        if (!*reached) {
+                memcpy(entry, incoming, 8 * sizeof(value_set));
+                *reached = true;
+                return true;
+        }
+
+        bool changed = false;
+
+        for (int i = 0; i < 8; i++) {
+                value_set before = entry[i];
+
+                if (incoming[i].count < 0) {
+                        entry[i].count = -1;
+                }
+                for (int j = 0; j < incoming[i].count; j++) {
+                        add_value(&entry[i], incoming[i].values[j]);
+                }
+
+                changed |= before.count != entry[i].count;
+        }
+
+        return changed;
+}
+
+/* Name: run_block
+ * Purpose: Simulate a block from its entry registers and record its exit
+ * Parameters: Program words, block, registers (updated to the exit state)
+ * Returns: none
+ * Effects: none
+ */
+static void run_block(const uint32_t *words, Dis_block *block,
+                      value_set registers[8])
+{
+        block->exit = DIS_FALLTHROUGH;
+        block->num_targets = 0;
+
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+                unsigned op = Bitpack_getu(words[pc], 4, 28);
+
+                if (op == 7) {
+                        block->exit = DIS_HALT;
+                } else if (op == 12) {
+                        classify_jump(words[pc], registers, block);
+                } else {
+                        simulate(words[pc], registers);
+                }
+        }
+}
+
+/* Name: Dis_find_blocks
+ * Purpose: Split a program image into basic blocks. Leaders are the first
+ *          word, every word after a HALT or LOAD_PROGRAM, and every
+ *          statically known target of a LOAD_PROGRAM within segment zero.
+ *          Register values are propagated forward along fallthrough edges
+ *          and known jumps until nothing changes. A block reached only
+ *          through unknown jumps (e.g. a return address) starts with
+ *          nothing known and does not feed its successors, so the targets
+ *          found are the ones implied by the statically visible paths.
+ *          Whenever a new target is found the blocks are rebuilt and the
+ *          analysis rerun.
+ * Parameters: Program words, number of words, address for the block count
+ * Returns: Malloced array of blocks in program order
+ * Effects: Checked runtime error if words or num_blocks is null or malloc
+ *          fails
+ */
+Dis_block *Dis_find_blocks(const uint32_t *words, uint32_t length,
+                           uint32_t *num_blocks)
+{
+        assert(num_blocks != NULL);
+        assert(words != NULL || length == 0);
+
+        bool *leader = calloc((size_t) length + 1, sizeof(bool));
+        uint32_t *block_of = malloc(((size_t) length + 1) * sizeof(uint32_t));
+        assert(leader != NULL && block_of != NULL);
+
+        leader[0] = true;
+        for (uint32_t pc = 0; pc < length; pc++) {
+                unsigned op = Bitpack_getu(words[pc], 4, 28);
+                if (op == 7 || op == 12) {
+                        leader[pc + 1] = true;
+                }
+        }
+
+        Dis_block *blocks = NULL;
+        uint32_t count = 0;
+        bool new_leader = true;
+
+        while (new_leader) {
+                new_leader = false;
+
+                /* Carve the image into blocks at the current leaders */
+                count = 0;
+                for (uint32_t pc = 0; pc < length; pc++) {
+                        count += leader[pc];
+                }
+
+                free(blocks);
+                blocks = malloc((count + 1) * sizeof(Dis_block));
+                assert(blocks != NULL);
+
+                uint32_t index = 0;
+                for (uint32_t pc = 0; pc < length; pc++) {
+                        if (leader[pc]) {
+                                blocks[index++].start = pc;
+                        }
+                        blocks[index - 1].end = pc + 1;
+                        block_of[pc] = index - 1;
+                }
+
+                /* Forward dataflow over the blocks, starting from the
+                   zeroed registers of a fresh machine */
+                value_set (*entry)[8] = malloc((count + 1) *
+                                               sizeof(*entry));
+                bool *reached = calloc(count + 1, sizeof(bool));
+                assert(entry != NULL && reached != NULL);
+
+                if (count > 0) {
+                        for (int i = 0; i < 8; i++) {
+                                set_single(&entry[0][i], 0);
+                        }
+                        reached[0] = true;
+                }
+
+                bool changed = true;
+                while (changed) {
+                        changed = false;
+
+                        for (uint32_t b = 0; b < count; b++) {
+                                value_set registers[8];
+
+                                if (!reached[b]) {
+                                        forget_all(registers);
+                                        run_block(words, &blocks[b],
+                                                  registers);
+                                        continue;
+                                }
+
+                                memcpy(registers, entry[b],
+                                       sizeof(registers));
+                                run_block(words, &blocks[b], registers);
+
+                                if (blocks[b].exit == DIS_FALLTHROUGH &&
+                                    b + 1 < count) {
+                                        changed |= join(entry[b + 1],
+                                                        &reached[b + 1],
+                                                        registers);
+                                }
+
+                                for (int i = 0; blocks[b].exit == DIS_JUMP &&
+                                                i < blocks[b].num_targets;
+                                     i++) {
+                                        uint32_t target =
+                                                blocks[b].targets[i];
+
+                                        if (target >= length) {
+                                                continue;
+                                        }
+                                        if (!leader[target]) {
+                                                leader[target] = true;
+                                                new_leader = true;
+                                                continue;
+                                        }
+                                        uint32_t t = block_of[target];
+                                        changed |= join(entry[t],
+                                                        &reached[t],
+                                                        registers);
+                                }
+                        }
+
+                        /* Restart with the new leaders before trusting any
+                           of the propagated values */
+                        if (new_leader) {
+                                break;
+                        }
+                }
+
+                free(entry);
+                free(reached);
+        }
+
+        free(leader);
+        free(block_of);
+
+        *num_blocks = count;
+        return blocks;
+}
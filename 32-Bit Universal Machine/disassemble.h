@@ -0,0 +1,44 @@
+/* Name: disassemble.h
+ * Interface for disassemble.c, which decodes 32-bit UM words into readable
+ * mnemonics and splits a program image into basic blocks
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef DISASSEMBLE_INCLUDED
+#define DISASSEMBLE_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Most LOAD_PROGRAM targets a block can statically be shown to reach */
+#define DIS_MAX_TARGETS 4
+
+typedef enum Dis_exit {
+        DIS_FALLTHROUGH = 0, /* Block runs into the next leader */
+        DIS_HALT,            /* Block ends with HALT */
+        DIS_JUMP,            /* LOAD_PROGRAM within segment zero */
+        DIS_FAR_JUMP,        /* LOAD_PROGRAM that replaces segment zero */
+        DIS_UNKNOWN_JUMP     /* LOAD_PROGRAM whose operands are not known */
+} Dis_exit;
+
+typedef struct Dis_block {
+        uint32_t start;  /* Program counter of the leader */
+        uint32_t end;    /* One past the last word of the block */
+        Dis_exit exit;
+        int num_targets; /* Known program counters for DIS_JUMP/FAR_JUMP */
+        uint32_t targets[DIS_MAX_TARGETS];
+} Dis_block;
+
+uint32_t *Dis_read_image(FILE *fp, uint32_t *length);
+
+const char *Dis_opcode_name(uint32_t word);
+void Dis_format(uint32_t word, char *buffer, size_t size);
+void Dis_describe(uint32_t word, char *buffer, size_t size);
+
+Dis_block *Dis_find_blocks(const uint32_t *words, uint32_t length,
+                           uint32_t *num_blocks);
+
+#endif
@@ -0,0 +1,187 @@
+/* Name: fork_server.c
+ * This module turns a warmed-up UM process into a server. Loading a program
+ * and running it up to the point where it first asks for input (unpacking,
+ * building tables, printing a banner) can take seconds, and a deployment
+ * that starts one UM per request pays that every time. Instead the UM
+ * stops at its first INPUT and forks: each child inherits the machine's
+ * memory copy-on-write, and continues from that INPUT with a client's
+ * connection as its I/O device.
+ *
+ * A client connects to the socket, writes the program's input, shuts down
+ * its writing side so the program sees end of input, and reads the output
+ * until the UM closes the connection:
+ *
+ *      um -F /tmp/um.sock program.um &
+ *      socat - UNIX-CONNECT:/tmp/um.sock < input > output
+ *
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "fork_server.h"
+
+/* Stands in for stdout until the first INPUT */
+static FILE *prelude_file = NULL;
+
+/* Name: Fork_server_prepare
+ * Purpose: Start capturing the program's output
+ * Parameters: none
+ * Returns: none
+ * Effects: stdout's descriptor refers to a temporary file until
+ *          Fork_server_serve. Checked runtime error if it cannot be made.
+ */
+void Fork_server_prepare(void)
+{
+        assert(prelude_file == NULL);
+
+        prelude_file = tmpfile();
+        assert(prelude_file != NULL);
+
+        fflush(stdout);
+        int rc = dup2(fileno(prelude_file), STDOUT_FILENO);
+        assert(rc == STDOUT_FILENO);
+}
+
+/* Name: read_prelude
+ * Purpose: Collect the output captured since Fork_server_prepare
+ * Parameters: Where to store its length
+ * Returns: Malloced bytes (NULL if there are none)
+ * Effects: Closes the temporary file
+ */
+static char *read_prelude(size_t *length)
+{
+        fflush(stdout);
+
+        /* stdout wrote through its own descriptor, find the end first */
+        fseek(prelude_file, 0, SEEK_END);
+        long size = ftell(prelude_file);
+        assert(size >= 0);
+        rewind(prelude_file);
+
+        char *bytes = NULL;
+        if (size > 0) {
+                bytes = malloc(size);
+                assert(bytes != NULL);
+                size_t got = fread(bytes, 1, size, prelude_file);
+                assert(got == (size_t) size);
+        }
+
+        fclose(prelude_file);
+        prelude_file = NULL;
+
+        *length = size;
+        return bytes;
+}
+
+/* Name: listen_on
+ * Purpose: Make a listening Unix stream socket
+ * Parameters: Path of the socket
+ * Returns: Listening descriptor
+ * Effects: Removes whatever was at path, checked runtime error if the path
+ *          is too long or the socket cannot be bound
+ */
+static int listen_on(const char *socket_path)
+{
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        assert(strlen(socket_path) < sizeof(address.sun_path));
+        strcpy(address.sun_path, socket_path);
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(listener >= 0);
+
+        unlink(socket_path);
+        int rc = bind(listener, (struct sockaddr *) &address,
+                      sizeof(address));
+        assert(rc == 0);
+        rc = listen(listener, 64);
+        assert(rc == 0);
+
+        return listener;
+}
+
+/* Name: write_all
+ * Purpose: Write every byte, retrying short writes
+ * Parameters: Descriptor, bytes, number of bytes
+ * Returns: none
+ * Effects: Gives up quietly if the client has gone away
+ */
+static void write_all(int fd, const char *bytes, size_t length)
+{
+        while (length > 0) {
+                ssize_t written = write(fd, bytes, length);
+                if (written < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (written <= 0) {
+                        return;
+                }
+                bytes += written;
+                length -= written;
+        }
+}
+
+/* Name: Fork_server_serve
+ * Purpose: Fork the warmed-up machine once per connection
+ * Parameters: Path of the Unix socket to listen on
+ * Returns: In each child, with stdin and stdout on the connection and the
+ *          captured output already sent
+ * Effects: The parent never returns. Children are reaped automatically.
+ *          Checked runtime error if Fork_server_prepare was not called or
+ *          the socket cannot be set up.
+ */
+void Fork_server_serve(const char *socket_path)
+{
+        assert(prelude_file != NULL && socket_path != NULL);
+
+        size_t prelude_length;
+        char *prelude = read_prelude(&prelude_length);
+
+        int listener = listen_on(socket_path);
+        signal(SIGCHLD, SIG_IGN);
+        signal(SIGPIPE, SIG_IGN);
+
+        fprintf(stderr, "um: warm, serving on %s\n", socket_path);
+
+        while (true) {
+                int connection = accept(listener, NULL, NULL);
+                if (connection < 0) {
+                        assert(errno == EINTR || errno == ECONNABORTED);
+                        continue;
+                }
+
+                pid_t child = fork();
+                if (child == 0) {
+                        close(listener);
+                        signal(SIGCHLD, SIG_DFL);
+                        signal(SIGPIPE, SIG_DFL);
+
+                        int in = dup2(connection, STDIN_FILENO);
+                        int out = dup2(connection, STDOUT_FILENO);
+                        assert(in == STDIN_FILENO && out == STDOUT_FILENO);
+                        close(connection);
+
+                        write_all(STDOUT_FILENO, prelude, prelude_length);
+                        free(prelude);
+                        clearerr(stdin);
+
+                        return;
+                }
+
+                if (child < 0) {
+                        perror("um: fork");
+                }
+                close(connection);
+        }
+}
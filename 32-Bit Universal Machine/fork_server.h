@@ -0,0 +1,23 @@
+/* Name: fork_server.h
+ * Interface for fork_server.c, which lets a UM that has already loaded and
+ * started a program serve many runs of it. The UM runs the program up to
+ * its first INPUT once, then forks a child per connection on a Unix socket,
+ * and each child finishes the run with the connection as stdin and stdout.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef FORK_SERVER_INCLUDED
+#define FORK_SERVER_INCLUDED
+
+/* Call before the program runs. Output written to stdout until
+ * Fork_server_serve is captured, and every client receives it first, just
+ * as a fresh run would have printed it. */
+void Fork_server_prepare(void);
+
+/* Listen on socket_path (replacing any socket already there) and fork a
+ * child per connection. Returns only in a child, whose stdin and stdout are
+ * the connection. The parent serves until it is killed. */
+void Fork_server_serve(const char *socket_path);
+
+#endif
@@ -7,6 +7,7 @@
  */
 
 #include "instruction_set.h"
+#include "bulk_memory.h"
 
 /* This constant is equivalent to 2^32 and is used for modulus operation to 
    keep all arithmetic operation results in the range of 0, 2^32 - 1 */
@@ -153,12 +154,14 @@ void unmap(universal_machine UM, UM_Reg C)
         unmap_segment(UM, index_to_unmap);
 }
 
-/* Name: unmap_segment
-*  Purpose: segment $m[$r[c]] is unmapped
-*  Parameters: UM, A, red_B, C
+/* Name: output
+*  Purpose: $r[C] is written to the I/O device
+*  Parameters: UM, C
 *  Returns: none
 *  Effects: Checked runtime error if value from register c
-*           is more than 255
+*           is more than 255. Goes to the client's output callback,
+*           through the writer thread's ring or into the spliced pages
+*           when the UM has one.
 */
 void output(universal_machine UM, UM_Reg C)
 {
@@ -167,7 +170,70 @@ void output(universal_machine UM, UM_Reg C)
         /* (8) Can't output value > 255 */
         assert(int_value <= 255);
 
-        putchar(int_value);
+        if (UM->output_fn != NULL) {
+                UM->output_fn(UM->io_closure, int_value);
+        }
+        else if (UM->output_ring != NULL) {
+                Async_output_put(UM->output_ring, int_value);
+        }
+        else if (UM->output_pages != NULL) {
+                Splice_output_put(UM->output_pages, int_value);
+        }
+        else {
+                putchar(int_value);
+        }
+}
+
+/* Name: output_block
+*  Purpose: $m[$r[A]][$r[B] + i] is written to the I/O device for every
+*           i < $r[C]
+*  Parameters: UM, A, B, C
+*  Returns: none
+*  Effects: Checked runtime error if the range is not all mapped or any of
+*           its words is more than 255, in which case nothing is written.
+*           Goes where output does; standard output gets one fwrite.
+*/
+void output_block(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C)
+{
+        uint32_t count = get_register(UM, C);
+        const UM_instruction *words = get_words(UM, get_register(UM, A),
+                                                get_register(UM, B), count);
+
+        for (uint32_t i = 0; i < count; i++) {
+                /* (8) Can't output value > 255 */
+                assert(words[i] <= 255);
+        }
+
+        if (UM->output_fn != NULL) {
+                for (uint32_t i = 0; i < count; i++) {
+                        UM->output_fn(UM->io_closure, words[i]);
+                }
+        }
+        else if (UM->output_ring != NULL) {
+                for (uint32_t i = 0; i < count; i++) {
+                        Async_output_put(UM->output_ring, words[i]);
+                }
+        }
+        else if (UM->output_pages != NULL) {
+                for (uint32_t i = 0; i < count; i++) {
+                        Splice_output_put(UM->output_pages, words[i]);
+                }
+        }
+        else {
+                unsigned char bytes[4096];
+
+                while (count > 0) {
+                        uint32_t chunk = count < sizeof(bytes) ? count
+                                                               : sizeof(bytes);
+                        for (uint32_t i = 0; i < chunk; i++) {
+                                bytes[i] = words[i];
+                        }
+                        fwrite(bytes, 1, chunk, stdout);
+
+                        words += chunk;
+                        count -= chunk;
+                }
+        }
 }
 
 /* Name: input
@@ -177,10 +243,21 @@ void output(universal_machine UM, UM_Reg C)
 *  Effects: instruction depend on I/O
 *           Checked runtime error if value is
 *.          out of range (has to be between 0 and 255)
+*           Pending asynchronous or spliced output is written before
+*           waiting.
+*           Reads from the client's input callback when there is one.
 */
 void input(universal_machine UM, UM_Reg C)
 {
-        int int_value = getchar();
+        if (UM->output_ring != NULL) {
+                Async_output_flush(UM->output_ring);
+        }
+        if (UM->output_pages != NULL) {
+                Splice_output_flush(UM->output_pages);
+        }
+
+        int int_value = UM->input_fn != NULL ? UM->input_fn(UM->io_closure)
+                                             : getchar();
 
         if (int_value == EOF) {
                 uint32_t all_ones = ~0;
@@ -207,27 +284,49 @@ void load_program(universal_machine UM, UM_Reg B)
         /* Not allowed to load segment zero into segment zero */
         if (B_value != 0) {
                 /* Checked runtime error if segment B_value DNE */
+                assert(B_value < (uint32_t) Seq_length(UM->segments));
                 segment target = (segment) Seq_get(UM->segments, B_value);
-                assert(target != NULL);
+                assert(target != NULL && target->valid);
                 
-                /* Perform deep copy of the $m[$r[B]] word instructions */
-                Seq_T duplicates = Seq_new(Seq_length(target->instructions));
+                /* Perform deep copy of the $m[$r[B]] words in one pass */
+                UM_instruction *duplicates = malloc(
+                        ((size_t) target->length + 1) *
+                        sizeof(UM_instruction));
                 assert(duplicates != NULL);
 
-                for (int i = 0; i < Seq_length(target->instructions); i++) {
-                        uint32_t word = get_instruction(UM, B_value, i);
-
-                        Seq_addhi(duplicates, (void *) (uintptr_t) word);
-                }
+                Bulk_copy32(duplicates, target->words, target->length);
 
-                /* Free instructions in segment zero and replace with new 
-                   instructions */
-                segment segment_zero = (segment) Seq_get(UM->segments, 0);
+                /* Free words in segment zero and replace with new words */
+                replace_segment_zero(UM, duplicates, target->length);
+        }       
+}
 
-                Seq_free(&(segment_zero->instructions));
+/* Name: block_copy
+*  Purpose: $m[$r[A]][$r[B] + i] := $m[$r[D]][$r[E] + i] for every i < $r[C]
+*  Parameters: UM, A, B, C, D, E
+*  Returns: none
+*  Effects: Overlapping ranges copy as though through a temporary.
+*           Checked runtime error if either range is not all mapped.
+*/
+void block_copy(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C,
+                UM_Reg D, UM_Reg E)
+{
+        copy_words(UM, get_register(UM, A), get_register(UM, B),
+                   get_register(UM, D), get_register(UM, E),
+                   get_register(UM, C));
+}
 
-                segment_zero->instructions = duplicates;
-        }       
+/* Name: block_fill
+*  Purpose: $m[$r[A]][$r[B] + i] := $r[D] for every i < $r[C]
+*  Parameters: UM, A, B, C, D
+*  Returns: none
+*  Effects: Checked runtime error if the range is not all mapped
+*/
+void block_fill(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C,
+                UM_Reg D)
+{
+        fill_words(UM, get_register(UM, A), get_register(UM, B),
+                   get_register(UM, D), get_register(UM, C));
 }
 
 /* Name: load_value
@@ -28,4 +28,23 @@ void input(universal_machine UM, UM_Reg C);
 void load_program(universal_machine UM, UM_Reg B);
 void load_value(universal_machine UM, UM_Reg A, uint32_t value);
 
+/* Extension: opcodes 14 and 15, which the spec leaves invalid (um -S keeps
+ * them so). Opcode 14 is a block operation chosen by bits 25-27 and names
+ * two more registers, D in bits 9-11 and E in bits 12-14:
+ *
+ *   BCOPY (0)  m[rA][rB + i] := m[rD][rE + i]   for i < rC
+ *   BFILL (1)  m[rA][rB + i] := rD              for i < rC
+ *
+ * Opcode 15, BOUT, writes m[rA][rB + i] for i < rC to the I/O device. A
+ * range that leaves its segment, another block operation, or a BOUT word
+ * above 255 is a failure, as for the single-word instructions. */
+#define BLOCK_COPY 0
+#define BLOCK_FILL 1
+
+void block_copy(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C,
+                UM_Reg D, UM_Reg E);
+void block_fill(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C,
+                UM_Reg D);
+void output_block(universal_machine UM, UM_Reg A, UM_Reg B, UM_Reg C);
+
 #endif
\ No newline at end of file
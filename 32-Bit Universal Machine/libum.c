@@ -0,0 +1,146 @@
+/* Name: libum.c
+ * This module wraps the universal machine (universal_machine, instruction_
+ * set, run_UM) in the embeddable interface of libum.h. The machine's I/O
+ * device becomes the host's callbacks, and the checked runtime errors that
+ * end the um executable become a LIBUM_FAILED status: the host process
+ * survives a failing program and can still free it.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <except.h>
+#include "libum.h"
+#include "run_UM.h"
+
+struct Libum {
+        universal_machine UM;
+        bool failed;
+        uint64_t instructions;  /* Executed over every Libum_run */
+        char error[96];
+};
+
+/* Name: Libum_new
+ * Purpose: Load a program image from memory into a new machine
+ * Parameters: Big-endian program bytes, number of bytes
+ * Returns: New machine with I/O on stdin/stdout, or NULL if size is not a
+ *          whole number of words
+ * Effects: Checked runtime error if allocation fails
+ */
+Libum_T Libum_new(const void *image, size_t size)
+{
+        if (size % 4 != 0 || (image == NULL && size != 0)) {
+                return NULL;
+        }
+
+        Libum_T um = calloc(1, sizeof(*um));
+        assert(um != NULL);
+
+        um->UM = read_program_buffer(image, size);
+
+        return um;
+}
+
+/* Name: Libum_free
+ * Purpose: Free a machine and every segment it mapped
+ * Parameters: Address of the machine
+ * Returns: none
+ * Effects: Checked runtime error if um or *um is null
+ */
+void Libum_free(Libum_T *um)
+{
+        assert(um != NULL && *um != NULL);
+
+        free_UM(&(*um)->UM);
+        free(*um);
+        *um = NULL;
+}
+
+/* Name: Libum_set_io
+ * Purpose: Attach the host's I/O device to the machine
+ * Parameters: Machine, input and output callbacks (NULL for stdin or
+ *             stdout), closure passed to both
+ * Returns: none
+ * Effects: Checked runtime error if um is null
+ */
+void Libum_set_io(Libum_T um, Libum_input_fn input, Libum_output_fn output,
+                  void *closure)
+{
+        assert(um != NULL);
+
+        um->UM->input_fn = input;
+        um->UM->output_fn = output;
+        um->UM->io_closure = closure;
+}
+
+/* Name: Libum_run
+ * Purpose: Run the program for a bounded number of instructions
+ * Parameters: Machine, instruction budget, where to store the number of
+ *             instructions run (may be NULL)
+ * Returns: LIBUM_HALTED, LIBUM_RUNNING if the budget ran out, LIBUM_FAILED
+ *          if the program hit a UM failure (now or on an earlier call)
+ * Effects: A failed machine stays failed, its state is left as it was at
+ *          the failing instruction, which is not counted as run
+ */
+Libum_status Libum_run(Libum_T um, uint64_t max_instructions,
+                       uint64_t *executed)
+{
+        assert(um != NULL);
+
+        if (executed != NULL) {
+                *executed = 0;
+        }
+        if (um->failed) {
+                return LIBUM_FAILED;
+        }
+
+        volatile Libum_status status = LIBUM_FAILED;
+        uint32_t start_pc = um->UM->program_counter;
+
+        TRY
+                run_limits limits = { max_instructions, 0 };
+                run_status ran = run_steps(um->UM, limits, NULL);
+                status = ran == RUN_HALTED ? LIBUM_HALTED : LIBUM_RUNNING;
+        EXCEPT(Assert_Failed)
+                um->failed = true;
+                snprintf(um->error, sizeof(um->error),
+                         "UM failure at program counter %u (slice began "
+                         "at %u)", (unsigned) um->UM->program_counter,
+                         (unsigned) start_pc);
+        END_TRY;
+
+        /* Also right after a failure, which longjmps past run_steps' own
+           report of the count */
+        uint64_t count = run_steps_count(um->UM);
+        um->instructions += count;
+        if (executed != NULL) {
+                *executed = count;
+        }
+
+        return status;
+}
+
+const char *Libum_error(Libum_T um)
+{
+        assert(um != NULL);
+        return um->failed ? um->error : NULL;
+}
+
+uint32_t Libum_register(Libum_T um, unsigned index)
+{
+        assert(um != NULL && index < 8);
+        return um->UM->registers[index];
+}
+
+uint32_t Libum_program_counter(Libum_T um)
+{
+        assert(um != NULL);
+        return um->UM->program_counter;
+}
+
+uint64_t Libum_instructions(Libum_T um)
+{
+        assert(um != NULL);
+        return um->instructions;
+}
@@ -0,0 +1,59 @@
+/* Name: libum.h
+ * Interface for libum.a, the universal machine as a library. A host loads a
+ * program image from memory, supplies the I/O device as callbacks and runs
+ * the machine in bounded slices, all in its own process.
+ *
+ *      Libum_T um = Libum_new(image, size);
+ *      Libum_set_io(um, read_byte, write_byte, &connection);
+ *      while (Libum_run(um, 1000000, NULL) == LIBUM_RUNNING)
+ *              ...do other work...
+ *      Libum_free(&um);
+ *
+ * Link with -lcii40 -lpthread.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef LIBUM_INCLUDED
+#define LIBUM_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct Libum *Libum_T;
+
+/* Returns the next input byte (0-255), or -1 at the end of input */
+typedef int (*Libum_input_fn)(void *closure);
+
+/* Receives one output byte */
+typedef void (*Libum_output_fn)(void *closure, unsigned char byte);
+
+typedef enum Libum_status {
+        LIBUM_HALTED,   /* The program executed HALT */
+        LIBUM_RUNNING,  /* The instruction budget ran out, run again */
+        LIBUM_FAILED    /* The program failed, see Libum_error */
+} Libum_status;
+
+/* image holds size bytes of big-endian words, as in a .um file. Returns
+ * NULL if size is not a multiple of 4. The image is copied. */
+Libum_T Libum_new(const void *image, size_t size);
+void Libum_free(Libum_T *um);
+
+/* Either callback may be NULL to use stdin or stdout */
+void Libum_set_io(Libum_T um, Libum_input_fn input, Libum_output_fn output,
+                  void *closure);
+
+/* Run at most max_instructions instructions. If executed is not NULL it
+ * receives the number run by this call. */
+Libum_status Libum_run(Libum_T um, uint64_t max_instructions,
+                       uint64_t *executed);
+
+/* Description of the failure once Libum_run returned LIBUM_FAILED */
+const char *Libum_error(Libum_T um);
+
+/* Machine state, for hosts that inspect or report on a program */
+uint32_t Libum_register(Libum_T um, unsigned index);
+uint32_t Libum_program_counter(Libum_T um);
+uint64_t Libum_instructions(Libum_T um);
+
+#endif
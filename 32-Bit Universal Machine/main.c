@@ -9,32 +9,347 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
 #include <assert.h>
 #include "run_UM.h"
 #include "universal_machine.h"
+#include "async_output.h"
+#include "splice_output.h"
+#include "disassemble.h"
+#include "checkpoint.h"
+
+/* Size of the output ring used with -a */
+#define ASYNC_OUTPUT_BYTES (1 << 20)
+
+/* Pipe size asked for with -p, the default limit for unprivileged users */
+#define SPLICE_OUTPUT_BYTES (1 << 20)
+
+/* Exit status when -b or -t stops the program, the same as timeout(1) */
+#define EXIT_LIMIT_REACHED 124
+
+/* Defaults for -c: seconds between checkpoints, increments between bases */
+#define CHECKPOINT_INTERVAL 60
+#define CHECKPOINT_MAX_INCREMENTS 16
+
+/* Default number of instructions kept by -T */
+#define TRACE_ENTRIES 65536
+
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-a | -p] [-s] [-S] [-b instructions] "
+                "[-t seconds] [-c prefix [-i seconds]]\n"
+                "          [-T file [-N entries]] program.um\n"
+                "       %s [options] -r prefix\n"
+                "  -a  write output from a separate thread\n"
+                "  -p  hand output pages to a pipe with vmsplice\n"
+                "  -s  print statistics when the program stops\n"
+                "  -S  strict spec: opcodes 14 and 15 (block copy, fill\n"
+                "      and output) are invalid\n"
+                "  -b  stop after this many instructions\n"
+                "  -t  stop after this much wall-clock time\n"
+                "  -c  write incremental checkpoints to prefix.ckpt*\n"
+                "  -i  seconds between checkpoints (default %d)\n"
+                "  -r  resume from the checkpoints at prefix.ckpt*\n"
+                "  -T  keep the last instructions run in a ring, written "
+                "to file\n"
+                "      on failure or signal (read it with umtrace)\n"
+                "  -N  instructions the ring keeps (default %d)\n",
+                program, program, CHECKPOINT_INTERVAL, TRACE_ENTRIES);
+        exit(EXIT_FAILURE);
+}
+
+/* Name: report_limit
+*  Purpose: Describe the machine where a limit stopped it
+*  Parameters: UM, why it stopped, instructions executed, stream
+*  Returns: none
+*  Effects: Writes the limit, program counter, current instruction,
+*           registers and number of mapped segments to fp
+*/
+static void report_limit(universal_machine UM, run_status status,
+                         uint64_t executed, FILE *fp)
+{
+        segment segment_zero = Seq_get(UM->segments, 0);
+        uint32_t pc = UM->program_counter;
+
+        fprintf(fp, "um: %s after %" PRIu64 " instructions\n",
+                status == RUN_TIMED_OUT ? "time limit reached"
+                                        : "instruction budget exhausted",
+                executed);
+
+        if (pc < segment_zero->length) {
+                char assembly[64];
+                Dis_format(segment_zero->words[pc], assembly,
+                           sizeof(assembly));
+                fprintf(fp, "um: next instruction %08" PRIx32 ": %s\n",
+                        pc, assembly);
+        }
+        else {
+                fprintf(fp, "um: program counter %08" PRIx32 " is past the "
+                        "end of segment zero\n", pc);
+        }
+
+        fprintf(fp, "um: registers");
+        for (int i = 0; i < 8; i++) {
+                fprintf(fp, " r%d=%08" PRIx32, i, UM->registers[i]);
+        }
+        fprintf(fp, "\num: %d segments mapped, segment zero is %" PRIu32
+                " words\n", Seq_length(UM->segments) -
+                Seq32_length(UM->unmapped_IDs), segment_zero->length);
+}
+
+/* Name: report_stats
+*  Purpose: Print how the run went
+*  Parameters: UM, instructions executed, stream
+*  Returns: none
+*  Effects: Writes the instruction count and the hit rate of the segment
+*           load/store inline cache to fp
+*/
+static void report_stats(universal_machine UM, uint64_t executed, FILE *fp)
+{
+        uint64_t hits = UM->cache_lookups - UM->cache_misses;
+
+        fprintf(fp, "um: %" PRIu64 " instructions\n", executed);
+        fprintf(fp, "um: %" PRIu64 " segment loads and stores, %" PRIu64
+                " inline cache hits (%.2f%%)\n", UM->cache_lookups, hits,
+                UM->cache_lookups == 0 ? 0.0
+                                       : 100.0 * hits / UM->cache_lookups);
+}
+
+/* Name: run_with_checkpoints
+*  Purpose: Run the machine within the limits, saving a checkpoint at every
+*           interval
+*  Parameters: UM, limits, checkpoint writer (NULL for none), seconds
+*              between checkpoints, where to store the instructions run
+*  Returns: How the run ended, as for run_steps
+*  Effects: The interval is only looked at every RUN_CHECK_INTERVAL
+*           instructions, like the deadline. A run that -b or -t stops
+*           also gets a checkpoint, so that it can be resumed exactly.
+*           Buffered output is written before every checkpoint.
+*/
+static run_status run_with_checkpoints(universal_machine UM,
+                                       run_limits limits,
+                                       Checkpoint_T writer, double interval,
+                                       uint64_t *executed)
+{
+        *executed = 0;
+
+        while (true) {
+                run_limits slice = limits;
+                uint64_t next_checkpoint = 0;
+
+                if (limits.instructions != UINT64_MAX) {
+                        slice.instructions = limits.instructions - *executed;
+                }
+                if (writer != NULL) {
+                        next_checkpoint = coarse_now_ns() +
+                                          (uint64_t) (interval * 1e9);
+                        if (slice.deadline_ns == 0 ||
+                            next_checkpoint < slice.deadline_ns) {
+                                slice.deadline_ns = next_checkpoint;
+                        }
+                }
+
+                uint64_t ran;
+                run_status status = run_steps(UM, slice, &ran);
+                *executed += ran;
+
+                if (writer == NULL || status == RUN_HALTED) {
+                        return status;
+                }
+
+                /* Output from before the checkpoint must be written out
+                   first: a run resumed from it does not repeat it */
+                fflush(stdout);
+                if (UM->output_ring != NULL) {
+                        Async_output_flush(UM->output_ring);
+                }
+                if (UM->output_pages != NULL) {
+                        Splice_output_flush(UM->output_pages);
+                }
+
+                /* A program stopped by -b or -t can be resumed from here */
+                Checkpoint_write(writer, UM);
+
+                if (status == RUN_SUSPENDED ||
+                    (limits.deadline_ns != 0 &&
+                     coarse_now_ns() >= limits.deadline_ns)) {
+                        return status;
+                }
+        }
+}
 
 /* Name: main
 *  Purpose: read file, call function to run program, and free memory
 *  Parameters: argc, argv
 *  Returns: int
 *  Effects:  Checked runtime if two files are not provided,
-*            file provided is empty, or UM is null
+*            file provided is empty, or UM is null. Exits with
+*            EXIT_LIMIT_REACHED if -b or -t stopped the program.
 */
 int main(int argc, char *argv[])
 {
-        assert(argc == 2);
+        bool async_output = false;
+        bool splice_output = false;
+        bool stats = false;
+        bool strict = false;
+        const char *checkpoint_prefix = NULL;
+        const char *resume_prefix = NULL;
+        double interval = CHECKPOINT_INTERVAL;
+        const char *trace_path = NULL;
+        uint32_t trace_entries = TRACE_ENTRIES;
+        run_limits limits = { UINT64_MAX, 0 };
+        double seconds = 0;
+        char *end;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "apsSb:t:c:i:r:T:N:")) != -1) {
+                switch (opt) {
+                        case 'a':
+                                async_output = true;
+                                break;
+                        case 'p':
+                                splice_output = true;
+                                break;
+                        case 's':
+                                stats = true;
+                                break;
+                        case 'S':
+                                strict = true;
+                                break;
+                        case 'b':
+                                /* strtoull takes blanks and a sign too */
+                                errno = 0;
+                                limits.instructions = strtoull(optarg, &end,
+                                                               10);
+                                if (!isdigit((unsigned char) optarg[0]) ||
+                                    *end != '\0' || errno == ERANGE) {
+                                        usage(argv[0]);
+                                }
+                                break;
+                        case 't':
+                                seconds = strtod(optarg, NULL);
+                                if (seconds <= 0) {
+                                        usage(argv[0]);
+                                }
+                                break;
+                        case 'c':
+                                checkpoint_prefix = optarg;
+                                break;
+                        case 'i':
+                                interval = strtod(optarg, NULL);
+                                if (interval <= 0) {
+                                        usage(argv[0]);
+                                }
+                                break;
+                        case 'r':
+                                resume_prefix = optarg;
+                                break;
+                        case 'T':
+                                trace_path = optarg;
+                                break;
+                        case 'N':
+                                trace_entries = strtoul(optarg, NULL, 10);
+                                if (trace_entries == 0 ||
+                                    trace_entries > (1u << 31)) {
+                                        usage(argv[0]);
+                                }
+                                break;
+                        default:
+                                usage(argv[0]);
+                }
+        }
 
-        FILE *fp = fopen(argv[1], "rb");
-        assert(fp != NULL);
+        if (optind != argc - (resume_prefix == NULL ? 1 : 0) ||
+            (async_output && splice_output)) {
+                usage(argv[0]);
+        }
 
-        universal_machine UM = read_program_file(fp);
-        //assert(UM != NULL);
+        universal_machine UM;
+        if (resume_prefix != NULL) {
+                UM = Checkpoint_restore(resume_prefix);
+                if (UM == NULL) {
+                        fprintf(stderr, "%s: no checkpoint at %s.ckpt\n",
+                                argv[0], resume_prefix);
+                        exit(EXIT_FAILURE);
+                }
+        }
+        else {
+                /* Segment zero comes from the program's .umx cache when it
+                   can */
+                UM = read_program_path(argv[optind]);
+        }
 
-        run_program(UM);
+        UM->strict = strict;
+
+        if (trace_path != NULL) {
+                UM->trace = Trace_open(trace_path, trace_entries);
+        }
+
+        Checkpoint_T writer = NULL;
+        if (checkpoint_prefix != NULL) {
+                writer = Checkpoint_new(checkpoint_prefix,
+                                        CHECKPOINT_MAX_INCREMENTS);
+        }
+
+        if (async_output) {
+                UM->output_ring = Async_output_new(STDOUT_FILENO,
+                                                   ASYNC_OUTPUT_BYTES);
+        }
+        else if (splice_output) {
+                fflush(stdout);
+                UM->output_pages = Splice_output_new(STDOUT_FILENO,
+                                                     SPLICE_OUTPUT_BYTES);
+        }
+
+        if (seconds > 0) {
+                limits.deadline_ns = coarse_now_ns() +
+                                     (uint64_t) (seconds * 1e9);
+        }
+
+        uint64_t executed;
+        run_status status = run_with_checkpoints(UM, limits, writer, interval,
+                                                 &executed);
+
+        if (UM->output_ring != NULL) {
+                Async_output_flush(UM->output_ring);
+                if (stats) {
+                        Async_output_report(UM->output_ring, stderr);
+                }
+                Async_output_free(&UM->output_ring);
+        }
+        if (UM->output_pages != NULL) {
+                Splice_output_flush(UM->output_pages);
+                if (stats) {
+                        Splice_output_report(UM->output_pages, stderr);
+                }
+                Splice_output_free(&UM->output_pages);
+        }
+
+        if (status != RUN_HALTED) {
+                fflush(stdout);
+                report_limit(UM, status, executed, stderr);
+        }
+
+        if (stats) {
+                fflush(stdout);
+                report_stats(UM, executed, stderr);
+        }
        
+        if (writer != NULL) {
+                Checkpoint_free(&writer);
+        }
+        if (UM->trace != NULL) {
+                /* A stopped run is worth a look too */
+                if (status != RUN_HALTED) {
+                        Trace_dump(UM->trace, 0);
+                }
+                Trace_close(&UM->trace);
+        }
         free_UM(&UM);
 
-        fclose(fp);
-
-        return 0;
+        return status == RUN_HALTED ? 0 : EXIT_LIMIT_REACHED;
 }
\ No newline at end of file
@@ -20,8 +20,10 @@ universal_machine read_program_file(FILE *fp)
 {
         assert(fp != NULL);
 
-        Seq_T program_instructions = Seq_new(100);
-        assert(program_instructions != NULL);
+        uint32_t capacity = 100;
+        uint32_t length = 0;
+        UM_instruction *program = malloc(capacity * sizeof(UM_instruction));
+        assert(program != NULL);
 
         uint32_t word = 0;
 
@@ -35,14 +37,63 @@ universal_machine read_program_file(FILE *fp)
                         byte = fgetc(fp);
                 }
 
-                Seq_addhi(program_instructions, (void *) (uintptr_t) word);
+                if (length == capacity) {
+                        capacity *= 2;
+                        program = realloc(program,
+                                          capacity * sizeof(UM_instruction));
+                        assert(program != NULL);
+                }
+
+                program[length++] = word;
         }
 
-        universal_machine UM = new_UM(program_instructions);
+        universal_machine UM = new_UM(program, length);
 
         return UM;
 }
 
+/* Name: read_program_path
+ * Purpose: Load the program at path, through its native-endian .umx cache
+ *          (see umx_cache.h) so that segment zero is a shared mapping
+ * Parameters: Path of the program file
+ * Returns: Pointer to universal machine structure with program instructions
+ * Effects: May create the program's .umx cache file, checked runtime
+ *          error if the program cannot be read
+ */
+universal_machine read_program_path(const char *path)
+{
+        assert(path != NULL);
+
+        return new_UM_from_image(Umx_load(path));
+}
+
+/* Name: read_program_buffer
+ * Purpose: Build a universal machine from a program image already in memory
+ * Parameters: Big-endian program bytes, number of bytes
+ * Returns: Pointer to universal machine structure with program instructions
+ * Effects: Checked runtime error if bytes is null or size is not a whole
+ *          number of words
+ */
+universal_machine read_program_buffer(const unsigned char *bytes,
+                                      size_t size)
+{
+        assert(bytes != NULL || size == 0);
+        assert(size % 4 == 0 && size / 4 <= UINT32_MAX);
+
+        uint32_t length = size / 4;
+        UM_instruction *program = malloc(((size_t) length + 1) *
+                                         sizeof(UM_instruction));
+        assert(program != NULL);
+
+        for (uint32_t i = 0; i < length; i++) {
+                const unsigned char *b = bytes + 4 * (size_t) i;
+                program[i] = (uint32_t) b[0] << 24 | (uint32_t) b[1] << 16 |
+                             (uint32_t) b[2] << 8 | b[3];
+        }
+
+        return new_UM(program, length);
+}
+
 void debug_registers(universal_machine UM)
 {
         for (size_t i = 0; i < 8; i++) {
@@ -54,66 +105,207 @@ void debug_registers(universal_machine UM)
  * Purpose: Command loop for each machine cycle 
  * Parameters: Pointer to instance of universal machine
  * Returns: Void
+ * Effects: Runs until HALT, see run_steps
+ */
+void run_program(universal_machine UM)
+{
+        run_limits no_limits = { UINT64_MAX, 0 };
+        run_steps(UM, no_limits, NULL);
+}
+
+/* Name: coarse_now_ns
+ * Purpose: Read the coarse monotonic clock, which costs a few nanoseconds
+ *          and is accurate to a scheduler tick, plenty for a watchdog
+ * Parameters: none
+ * Returns: Nanoseconds since an arbitrary start
+ * Effects: none
+ */
+uint64_t coarse_now_ns(void)
+{
+        struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+        return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Name: run_steps
+ * Purpose: Command loop that stops at HALT or when a limit is reached
+ * Parameters: Pointer to instance of universal machine, limits, where to
+ *             store the number of instructions executed (may be NULL)
+ * Returns: RUN_HALTED once HALT executes (the program counter stays on the
+ *          HALT), RUN_SUSPENDED once exactly limits.instructions have run,
+ *          RUN_TIMED_OUT once the deadline has passed
  * Effects: Checked runtime error if program counter is out of bounds, invalid
  * OP_CODE, and if segment zero was unavailable 
+ *
+ * Limits are only looked at between slices. A slice ends at a LOAD_PROGRAM
+ * or after RUN_CHECK_INTERVAL straight-line instructions, whichever comes
+ * first, and the end of a straight-line slice is folded into the bounds
+ * check on segment zero, so the inner loop does no extra work per
+ * instruction. The deadline cannot interrupt an INPUT that is waiting.
+ * Each slice records the count so far in the UM, so that a caller that
+ * catches a failure can still learn it from run_steps_count.
  */
-void run_program(universal_machine UM)
+run_status run_steps(universal_machine UM, run_limits limits,
+                     uint64_t *executed)
 {
         assert(UM != NULL);
 
-        while (true) {
-                /* Get segment zero data */
-                segment segment_zero = Seq_get(UM->segments, 0);
-                assert(segment_zero != NULL);
-                
-                Seq_T words = segment_zero->instructions;
+        run_status status = RUN_SUSPENDED;
+        uint64_t count = 0;
+        uint64_t next_clock_check = RUN_CHECK_INTERVAL;
+
+        /* Segment zero itself is never unmapped, only its words replaced */
+        segment segment_zero = Seq_get(UM->segments, 0);
+        assert(segment_zero != NULL);
+
+        Trace_ring *trace = UM->trace;
+
+        while (count < limits.instructions) {
+                UM_instruction *words = segment_zero->words;
                 assert(words != NULL);
 
                 /* (1) Check program counter is within bounds of segment zero */
-                uint32_t max_index = Seq_length(words) - 1;
-                assert(UM->program_counter <= max_index);
-                
-                UM_instruction word = (uintptr_t) Seq_get(words, 
-                                                         UM->program_counter);
-                   
-                int OP_CODE = Bitpack_getu(word, 4, 28);
-
-                /* (2) Check whether code corresponds to an instruction */
-                assert(OP_CODE >= 0 && OP_CODE <= 13);
-                
-                UM_Reg A, B, C;
-
-                /* Halt Command, exit function to free data */
-                if (OP_CODE == 7) {
-                        return;
+                uint32_t start = UM->program_counter;
+                UM->steps_done = count;
+                UM->slice_start = start;
+                assert(start < segment_zero->length);
+
+                /* Stop the slice at the end of segment zero, or earlier at
+                   the check interval or the end of the budget */
+                uint64_t window = limits.instructions - count;
+                if (window > RUN_CHECK_INTERVAL) {
+                        window = RUN_CHECK_INTERVAL;
+                }
+                uint32_t stop = segment_zero->length;
+                if (window < (uint64_t) (stop - start)) {
+                        stop = start + window;
                 }
-                /* Special Load Value Command */
-                else if (OP_CODE == 13) {
-                        A = Bitpack_getu(word, 3, 25);
-                        int load_val = Bitpack_getu(word, 25, 0);
+
+                bool jumped = false;
+
+                while (UM->program_counter < stop) {
+                        UM_instruction word = words[UM->program_counter];
+
+                        if (trace != NULL) {
+                                Trace_record(trace, UM->program_counter, word,
+                                             UM->registers);
+                        }
+                        
+                        int OP_CODE = Bitpack_getu(word, 4, 28);
+
+                        /* (2) Check whether code corresponds to an
+                           instruction, opcodes 14 and 15 only with the
+                           block extension on */
+                        assert(OP_CODE >= 0 && OP_CODE <= 15);
+                        assert(OP_CODE <= 13 || !UM->strict);
+                        
+                        UM_Reg A, B, C;
+
+                        /* Halt Command, exit function to free data */
+                        if (OP_CODE == 7) {
+                                count += UM->program_counter - start + 1;
+                                status = RUN_HALTED;
+                                goto done;
+                        }
+                        /* Special Load Value Command */
+                        else if (OP_CODE == 13) {
+                                A = Bitpack_getu(word, 3, 25);
+                                int load_val = Bitpack_getu(word, 25, 0);
+                                
+                                load_value(UM, A, load_val);
+                        }
+                        /* Block extension, see instruction_set.h */
+                        else if (OP_CODE == 14) {
+                                run_block(UM, word);
+                        }
+                        /* Other 12 instructions */
+                        else {
+                                A = Bitpack_getu(word, 3, 6);
+                                B = Bitpack_getu(word, 3, 3);
+                                C = Bitpack_getu(word, 3, 0);
+                            
+                                run_helper(UM, OP_CODE, A, B, C);
+                        }        
+
+                        if (OP_CODE == 12) {
+                                count += UM->program_counter - start + 1;
+                                UM->program_counter = get_register(UM, C);
+                                jumped = true;
+                                break;
+                        }
                         
-                        load_value(UM, A, load_val);
+                        UM->program_counter++;
                 }
-                /* Other 12 instructions */
-                else {
-                        A = Bitpack_getu(word, 3, 6);
-                        B = Bitpack_getu(word, 3, 3);
-                        C = Bitpack_getu(word, 3, 0);
-                    
-                        run_helper(UM, OP_CODE, A, B, C);
-                }        
-
-                if (OP_CODE == 12) {
-                        UM->program_counter = get_register(UM, C);
+
+                if (!jumped) {
+                        count += stop - start;
                 }
-                else {
-                        UM->program_counter++;
+
+                if (limits.deadline_ns != 0 && count >= next_clock_check) {
+                        next_clock_check = count + RUN_CHECK_INTERVAL;
+                        if (coarse_now_ns() >= limits.deadline_ns) {
+                                status = RUN_TIMED_OUT;
+                                break;
+                        }
                 }
         }
+
+done:
+        UM->steps_done = count;
+        UM->slice_start = UM->program_counter;
+        if (executed != NULL) {
+                *executed = count;
+        }
+
+        return status;
+}
+
+/* Name: run_steps_count
+ * Purpose: Number of instructions the last run_steps call finished
+ * Parameters: Pointer to instance of universal machine
+ * Returns: The count, which after a checked runtime error leaves out the
+ *          instruction that failed
+ * Effects: Checked runtime error if UM is null
+ */
+uint64_t run_steps_count(universal_machine UM)
+{
+        assert(UM != NULL);
+
+        return UM->steps_done + (UM->program_counter - UM->slice_start);
+}
+
+/* Name: run_block
+*  Purpose: Decode and run a block operation (opcode 14)
+*  Parameters: UM, instruction word
+*  Returns: none
+*  Effects: Checked runtime error for an unknown block operation
+*/
+void run_block(universal_machine UM, UM_instruction word)
+{
+        UM_Reg A = Bitpack_getu(word, 3, 6);
+        UM_Reg B = Bitpack_getu(word, 3, 3);
+        UM_Reg C = Bitpack_getu(word, 3, 0);
+        UM_Reg D = Bitpack_getu(word, 3, 9);
+        UM_Reg E = Bitpack_getu(word, 3, 12);
+
+        switch (Bitpack_getu(word, 3, 25)) {
+                case BLOCK_COPY:
+                        block_copy(UM, A, B, C, D, E);
+                        break;
+                case BLOCK_FILL:
+                        block_fill(UM, A, B, C, D);
+                        break;
+                default:
+                        assert(0);
+        }
 }
 
 /* Name: run_helper
-*  Purpose: Handles non load value instruction cases  op codes 0-12
+*  Purpose: Handles non load value instruction cases  op codes 0-12 and 15
 *  Parameters: UM, OP_CODE, A, B, C
 *  Returns: none
 *  Effects: helps choose which case/function to call
@@ -158,5 +350,8 @@ void run_helper(universal_machine UM, int OP_CODE, UM_Reg A,
                 case 12:
                         load_program(UM, B);
                         break;
+                case 15:
+                        output_block(UM, A, B, C);
+                        break;
         }
 }
\ No newline at end of file
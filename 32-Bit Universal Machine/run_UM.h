@@ -12,14 +12,40 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 #include "bitpack.h"
 #include "universal_machine.h"
 #include "instruction_set.h"
 
+/* Straight-line instructions run between checks of the limits */
+#define RUN_CHECK_INTERVAL 65536
+
+/* Limits on a run, checked only every RUN_CHECK_INTERVAL instructions and
+ * at each LOAD_PROGRAM */
+typedef struct run_limits {
+        uint64_t instructions;  /* UINT64_MAX for no budget */
+        uint64_t deadline_ns;   /* coarse_now_ns() deadline, 0 for none */
+} run_limits;
+
+/* Outcome of a bounded run */
+typedef enum run_status {
+        RUN_HALTED,     /* Executed HALT */
+        RUN_SUSPENDED,  /* Instruction budget used up, can be resumed */
+        RUN_TIMED_OUT   /* Deadline passed, can be resumed */
+} run_status;
+
 universal_machine read_program_file(FILE *fp);
+universal_machine read_program_path(const char *path);
+universal_machine read_program_buffer(const unsigned char *bytes,
+                                      size_t size);
 void run_program(universal_machine UM);
+run_status run_steps(universal_machine UM, run_limits limits,
+                     uint64_t *executed);
+uint64_t run_steps_count(universal_machine UM);
+uint64_t coarse_now_ns(void);
 void run_helper(universal_machine UM, int OP_CODE, UM_Reg A,
                  UM_Reg B, UM_Reg C);
+void run_block(universal_machine UM, UM_instruction word);
 
 /* Private Helper */
 uint32_t read_word_helper(FILE *fp);
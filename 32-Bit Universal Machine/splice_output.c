@@ -0,0 +1,208 @@
+/* Name: splice_output.c
+ * This module implements splice_output.h. vmsplice puts references to the
+ * buffer's pages in the pipe rather than copies of the bytes, so a page may
+ * not be written again until the reader has consumed it. The buffers are
+ * the pipe's size and are spliced whole, so by the time one buffer has
+ * gone into the pipe, which holds no more than that, everything queued
+ * before it, including the other buffer, has been read: each buffer can
+ * be refilled as soon as the other one has been handed over. The reader
+ * drains one buffer while the interpreter fills the other.
+ *
+ * Partial buffers (a flush before INPUT or at the end) are written with
+ * write, which copies, so the buffer can be refilled right away and the
+ * rule above still holds for whatever is spliced next.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "splice_output.h"
+
+/* Name: pipe_size
+ * Purpose: Grow the pipe on fd toward capacity and find its size
+ * Parameters: File descriptor, bytes wanted
+ * Returns: The pipe's capacity in bytes, 0 if fd is not a pipe
+ * Effects: The pipe keeps its old size when it cannot grow (pipe-max-size)
+ */
+static size_t pipe_size(int fd, size_t capacity)
+{
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISFIFO(info.st_mode)) {
+                return 0;
+        }
+
+#ifdef F_SETPIPE_SZ
+        fcntl(fd, F_SETPIPE_SZ, (int) capacity);
+        int size = fcntl(fd, F_GETPIPE_SZ);
+        return size > 0 ? (size_t) size : 0;
+#else
+        (void) capacity;
+        return 0;
+#endif
+}
+
+/* Name: Splice_output_new
+ * Purpose: Allocate the two buffers for output to fd
+ * Parameters: File descriptor, bytes per buffer (rounded up to whole pages)
+ * Returns: New output
+ * Effects: Resizes the pipe fd refers to. Checked runtime error if
+ *          allocation fails.
+ */
+Splice_output Splice_output_new(int fd, size_t capacity)
+{
+        assert(fd >= 0 && capacity > 0);
+
+        size_t page = sysconf(_SC_PAGESIZE);
+        capacity = (capacity + page - 1) / page * page;
+
+        Splice_output out = calloc(1, sizeof(*out));
+        assert(out != NULL);
+
+        out->fd = fd;
+        out->size = pipe_size(fd, capacity);
+        out->splicing = out->size > 0 && out->size % page == 0;
+        if (!out->splicing) {
+                out->size = capacity;
+        }
+
+        for (int i = 0; i < 2; i++) {
+                void *buffer = NULL;
+                int rc = posix_memalign(&buffer, page, out->size);
+                assert(rc == 0);
+                out->buffers[i] = buffer;
+        }
+
+        out->which = 0;
+        out->current = out->buffers[0];
+
+        return out;
+}
+
+/* Name: Splice_output_free
+ * Purpose: Write what is left and release the buffers
+ * Parameters: Address of the output
+ * Returns: none
+ * Effects: Checked runtime error if out or *out is null
+ */
+void Splice_output_free(Splice_output *out)
+{
+        assert(out != NULL && *out != NULL);
+
+        Splice_output_flush(*out);
+
+        free((*out)->buffers[0]);
+        free((*out)->buffers[1]);
+        free(*out);
+        *out = NULL;
+}
+
+/* Name: write_all
+ * Purpose: Copy bytes to fd, retrying short writes
+ * Parameters: Output, bytes, length
+ * Returns: none
+ * Effects: Sets failed if the descriptor returns an error
+ */
+static void write_all(Splice_output out, const unsigned char *bytes,
+                      size_t length)
+{
+        while (length > 0 && !out->failed) {
+                ssize_t written = write(out->fd, bytes, length);
+
+                if (written < 0) {
+                        if (errno != EINTR) {
+                                out->failed = true;
+                        }
+                        continue;
+                }
+
+                out->written += written;
+                bytes += written;
+                length -= written;
+        }
+}
+
+/* Name: splice_all
+ * Purpose: Hand a whole buffer to the pipe
+ * Parameters: Output, buffer, length
+ * Returns: none
+ * Effects: Falls back to write for good if the descriptor turns out not
+ *          to take vmsplice, e.g. after the fork server replaced it
+ */
+static void splice_all(Splice_output out, unsigned char *bytes, size_t length)
+{
+        while (length > 0 && !out->failed) {
+                struct iovec iov = { bytes, length };
+                ssize_t spliced = vmsplice(out->fd, &iov, 1, 0);
+
+                if (spliced < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        if (errno == EINVAL || errno == EBADF ||
+                            errno == ENOSYS) {
+                                out->splicing = false;
+                                write_all(out, bytes, length);
+                        }
+                        else {
+                                out->failed = true;
+                        }
+                        return;
+                }
+
+                out->spliced += spliced;
+                bytes += spliced;
+                length -= spliced;
+        }
+}
+
+void Splice_output_send(Splice_output out)
+{
+        assert(out != NULL);
+
+        if (out->splicing) {
+                splice_all(out, out->current, out->used);
+
+                /* The other buffer was queued before this one, so it has
+                   been read */
+                out->which ^= 1;
+                out->current = out->buffers[out->which];
+        }
+        else {
+                write_all(out, out->current, out->used);
+        }
+
+        out->used = 0;
+}
+
+void Splice_output_flush(Splice_output out)
+{
+        assert(out != NULL);
+
+        write_all(out, out->current, out->used);
+        out->used = 0;
+}
+
+/* Name: Splice_output_report
+ * Purpose: Print how much output was spliced and how much copied
+ * Parameters: Output, stream to print to
+ * Returns: none
+ * Effects: Checked runtime error if out or fp is null
+ */
+void Splice_output_report(Splice_output out, FILE *fp)
+{
+        assert(out != NULL && fp != NULL);
+
+        fprintf(fp, "splice output: %" PRIu64 " bytes spliced, %" PRIu64
+                " bytes written, buffers of %zu bytes%s\n", out->spliced,
+                out->written, out->size,
+                out->splicing ? "" : " (not a pipe)");
+}
@@ -0,0 +1,53 @@
+/* Name: splice_output.h
+ * Interface for splice_output.c, UM output collected in two page-aligned
+ * buffers that are handed to a pipe with vmsplice instead of copied into
+ * it, or written as usual when the descriptor is not a pipe
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef SPLICE_OUTPUT_INCLUDED
+#define SPLICE_OUTPUT_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct Splice_output {
+        unsigned char *current; /* Buffer being filled */
+        size_t used;            /* Bytes in it so far */
+        size_t size;            /* Bytes per buffer, the pipe's capacity */
+        unsigned char *buffers[2];
+        unsigned which;         /* Index of current in buffers */
+        int fd;
+        bool splicing;          /* fd is a pipe that takes vmsplice */
+        bool failed;            /* fd returned an error, output is dropped */
+
+        uint64_t spliced;       /* Bytes handed over with vmsplice */
+        uint64_t written;       /* Bytes copied with write */
+} *Splice_output;
+
+/* The buffers are as large as the pipe, which is first asked to grow to
+ * capacity bytes; capacity is used as is when fd is not a pipe */
+Splice_output Splice_output_new(int fd, size_t capacity);
+void Splice_output_free(Splice_output *out);
+
+/* Hand over the full current buffer and start filling the other one */
+void Splice_output_send(Splice_output out);
+
+/* Write the bytes collected so far, e.g. before the UM waits on INPUT */
+void Splice_output_flush(Splice_output out);
+
+void Splice_output_report(Splice_output out, FILE *fp);
+
+static inline void Splice_output_put(Splice_output out, unsigned char byte)
+{
+        out->current[out->used++] = byte;
+
+        if (out->used == out->size) {
+                Splice_output_send(out);
+        }
+}
+
+#endif
@@ -173,7 +173,7 @@ int main(int argc, char *argv[])
 
                         segment seg_zero = (segment) Seq_get(UM->segments, 0);
 
-                printf("Seq Length %d\n", Seq_length(seg_zero->instructions));
+                printf("Seq Length %u\n", seg_zero->length);
                         
                         break;
                 case 52:
@@ -0,0 +1,124 @@
+/* Name: trace_ring.c
+ * This module keeps the trace ring of trace_ring.h. Recording is a few
+ * stores into memory that stays in cache, with no test for a full ring,
+ * so the ring can stay on for production runs. The file is opened when
+ * the ring is, and a dump is a couple of pwrite calls, which a signal
+ * handler may make; the program's failure paths all end in a signal
+ * (Hanson's assert aborts), so one handler covers them all.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include "trace_ring.h"
+
+/* The ring the signal handler dumps */
+static Trace_ring *active_ring = NULL;
+
+static const int fatal_signals[] = { SIGABRT, SIGSEGV, SIGBUS, SIGFPE,
+                                     SIGINT, SIGTERM };
+
+/* Name: dump_on_signal
+ * Purpose: Dump the active ring, then let a fatal signal do what it would
+ *          have done
+ * Parameters: Signal number
+ * Returns: Only for SIGUSR1
+ * Effects: Restores the default action of a fatal signal and raises it
+ *          again
+ */
+static void dump_on_signal(int signo)
+{
+        if (active_ring != NULL) {
+                Trace_dump(active_ring, signo);
+        }
+
+        if (signo != SIGUSR1) {
+                signal(signo, SIG_DFL);
+                raise(signo);
+        }
+}
+
+/* Name: Trace_open
+ * Purpose: Start recording executed instructions
+ * Parameters: Path of the dump file, number of entries to keep
+ * Returns: Empty ring
+ * Effects: Truncates path, installs the signal handlers. Checked runtime
+ *          error if allocation fails or the file cannot be created.
+ */
+Trace_ring *Trace_open(const char *path, uint32_t capacity)
+{
+        assert(path != NULL && capacity > 0 && capacity <= (1u << 31));
+
+        uint32_t rounded = 1;
+        while (rounded < capacity) {
+                rounded <<= 1;
+        }
+
+        Trace_ring *ring = calloc(1, sizeof(*ring));
+        assert(ring != NULL);
+        ring->entries = calloc(rounded, sizeof(Trace_entry));
+        assert(ring->entries != NULL);
+        ring->mask = rounded - 1;
+
+        ring->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert(ring->fd >= 0);
+
+        active_ring = ring;
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = dump_on_signal;
+        sigemptyset(&action.sa_mask);
+        for (size_t i = 0; i < sizeof(fatal_signals) / sizeof(int); i++) {
+                sigaction(fatal_signals[i], &action, NULL);
+        }
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, NULL);
+
+        return ring;
+}
+
+void Trace_close(Trace_ring **ring)
+{
+        assert(ring != NULL && *ring != NULL);
+
+        if (active_ring == *ring) {
+                active_ring = NULL;
+        }
+
+        close((*ring)->fd);
+        free((*ring)->entries);
+        free(*ring);
+        *ring = NULL;
+}
+
+/* Name: Trace_dump
+ * Purpose: Write the ring's header and entries to its file
+ * Parameters: Ring, signal that caused the dump (0 if none)
+ * Returns: none
+ * Effects: Replaces an earlier dump. Async-signal-safe.
+ */
+void Trace_dump(Trace_ring *ring, int reason)
+{
+        Trace_header header;
+        memset(&header, 0, sizeof(header));
+        header.magic = TRACE_MAGIC;
+        header.version = TRACE_VERSION;
+        header.byte_order = TRACE_BYTE_ORDER;
+        header.entry_size = sizeof(Trace_entry);
+        header.capacity = ring->mask + 1;
+        header.reason = reason;
+        header.count = ring->count;
+
+        size_t bytes = (size_t) header.capacity * sizeof(Trace_entry);
+        ssize_t written = pwrite(ring->fd, &header, sizeof(header), 0);
+        if (written == (ssize_t) sizeof(header)) {
+                written = pwrite(ring->fd, ring->entries, bytes,
+                                 sizeof(header));
+        }
+        (void) written;
+}
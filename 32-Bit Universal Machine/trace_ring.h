@@ -0,0 +1,68 @@
+/* Name: trace_ring.h
+ * Interface for trace_ring.c, a fixed-size ring of the instructions a UM
+ * executed last, written to a file when the program fails or the process
+ * gets a signal, and read back by umtrace
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef TRACE_RING_INCLUDED
+#define TRACE_RING_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TRACE_MAGIC 0x31544d55u         /* "UMT1" in little-endian order */
+#define TRACE_VERSION 1
+#define TRACE_BYTE_ORDER 0x01020304u
+
+/* One executed instruction. a, b and c are the registers named by bits
+ * 6-8, 3-5 and 0-2 of the word, as they were before it ran. */
+typedef struct Trace_entry {
+        uint32_t pc;
+        uint32_t word;
+        uint32_t a, b, c;
+} Trace_entry;
+
+/* Trace file: this header, then capacity entries in ring order. Entry
+ * number n (counting from 0) is at index n % capacity. */
+typedef struct Trace_header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t entry_size;
+        uint32_t capacity;
+        int32_t reason;         /* Signal that caused the dump, 0 if none */
+        uint64_t count;         /* Entries recorded over the whole run */
+} Trace_header;
+
+typedef struct Trace_ring {
+        uint64_t count;
+        uint32_t mask;          /* capacity - 1 */
+        Trace_entry *entries;
+        int fd;                 /* File the ring is dumped to */
+} Trace_ring;
+
+/* capacity is rounded up to a power of two. Opens path right away, so
+ * that a dump needs no allocation, and arranges for a dump on SIGABRT
+ * (every failed checked runtime error), SIGSEGV, SIGBUS, SIGFPE, SIGINT,
+ * SIGTERM and SIGUSR1. Only SIGUSR1 lets the program continue. */
+Trace_ring *Trace_open(const char *path, uint32_t capacity);
+void Trace_close(Trace_ring **ring);
+
+/* Write the ring to its file now */
+void Trace_dump(Trace_ring *ring, int reason);
+
+static inline void Trace_record(Trace_ring *ring, uint32_t pc,
+                                uint32_t word, const uint32_t *registers)
+{
+        Trace_entry *entry = &ring->entries[ring->count++ & ring->mask];
+
+        entry->pc = pc;
+        entry->word = word;
+        entry->a = registers[(word >> 6) & 7];
+        entry->b = registers[(word >> 3) & 7];
+        entry->c = registers[word & 7];
+}
+
+#endif
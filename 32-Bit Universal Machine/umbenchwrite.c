@@ -0,0 +1,135 @@
+/*
+ * umbenchwrite.c
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ *
+ * Writes the UM stress programs built in unit_benchmarks.c, one image per
+ * benchmark named bench_<name>.um. Each stresses one interpreter
+ * subsystem so they can be timed in isolation.
+ *
+ * Usage: umbench [-n instructions] [-w words] [benchmark ...]
+ *      -n      about how many instructions each program executes
+ *              (default 100000000)
+ *      -w      segment size in words for sweep and churn_large, and the
+ *              padded program size for far_jump (default 65536)
+ * With no benchmark names every benchmark is written.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "fmt.h"
+#include "seq.h"
+#include "umlab.h"
+
+/* The array `benchmarks` contains every stress program. */
+
+static struct bench_info {
+        const char *name;
+        const char *description;
+        /* writes instructions into sequence */
+        void (*build_bench)(Seq_T stream, uint64_t instructions,
+                            uint32_t words);
+} benchmarks[] = {
+        { "arith", "ADD/MUL/NAND/DIV chain", build_bench_arith },
+        { "sweep", "SLOAD/SSTORE over one segment of -w words",
+          build_bench_sweep },
+        { "churn_small", "map/unmap, 0-15 words", build_bench_churn_small },
+        { "churn_mixed", "map/unmap, 0-4095 words", build_bench_churn_mixed },
+        { "churn_skewed", "map/unmap, squares of 0-255 words",
+          build_bench_churn_skewed },
+        { "churn_large", "map/unmap, -w words", build_bench_churn_large },
+        { "far_jump", "LOAD_PROGRAM of a -w word program",
+          build_bench_far_jump },
+        { "output", "OUTPUT flood", build_bench_output }
+};
+
+#define NBENCHMARKS (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+static void write_benchmark(struct bench_info *bench, uint64_t instructions,
+                            uint32_t words);
+static void usage(const char *program);
+
+
+int main(int argc, char *argv[])
+{
+        uint64_t instructions = 100000000;
+        uint32_t words = 65536;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "n:w:")) != -1) {
+                switch (opt) {
+                        case 'n':
+                                instructions = strtoull(optarg, NULL, 10);
+                                break;
+                        case 'w':
+                                words = strtoul(optarg, NULL, 10);
+                                break;
+                        default:
+                                usage(argv[0]);
+                                return EXIT_FAILURE;
+                }
+        }
+
+        if (words == 0 || words >= (1u << 25)) {
+                fprintf(stderr, "%s: -w must be between 1 and %u\n",
+                        argv[0], (1u << 25) - 1);
+                return EXIT_FAILURE;
+        }
+
+        bool failed = false;
+        if (optind == argc)
+                for (unsigned i = 0; i < NBENCHMARKS; i++)
+                        write_benchmark(&benchmarks[i], instructions, words);
+        else
+                for (int j = optind; j < argc; j++) {
+                        bool written = false;
+                        for (unsigned i = 0; i < NBENCHMARKS; i++)
+                                if (!strcmp(benchmarks[i].name, argv[j])) {
+                                        written = true;
+                                        write_benchmark(&benchmarks[i],
+                                                        instructions, words);
+                                }
+                        if (!written) {
+                                failed = true;
+                                fprintf(stderr,
+                                        "***** No benchmark named %s *****\n",
+                                        argv[j]);
+                        }
+                }
+        return failed; /* failed nonzero == exit nonzero == failure */
+}
+
+
+static void write_benchmark(struct bench_info *bench, uint64_t instructions,
+                            uint32_t words)
+{
+        printf("***** Writing benchmark '%s' (%s).\n", bench->name,
+               bench->description);
+
+        char *path = Fmt_string("bench_%s.um", bench->name);
+        FILE *binary = fopen(path, "wb");
+        assert(binary != NULL);
+        free(path);
+
+        Seq_T stream = Seq_new(0);
+        bench->build_bench(stream, instructions, words);
+        Um_write_sequence(binary, stream);
+        Seq_free(&stream);
+        fclose(binary);
+}
+
+
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-n instructions] [-w words] "
+                "[benchmark ...]\nBenchmarks:", program);
+        for (unsigned i = 0; i < NBENCHMARKS; i++) {
+                fprintf(stderr, " %s", benchmarks[i].name);
+        }
+        fprintf(stderr, "\n");
+}
@@ -0,0 +1,283 @@
+/* Name: umdis.c
+ * Purpose: umdis prints a UM program image as basic blocks of mnemonics.
+ * Given a profile written by an instrumented UM run (see UM_PROFILE in
+ * Profiled UM/main.c) each block is annotated with its execution count and
+ * its share of the instructions executed in that generation of code, and
+ * the hottest blocks are listed.
+ *
+ * Usage: umdis [-p profile] [-g generation] [-n hottest] program.um
+ *
+ * Profile format: lines starting with '#' are comments, every other line is
+ * "<generation> <program counter> <count>". Generation 0 is the code in the
+ * program file, and each LOAD_PROGRAM that replaces segment zero starts the
+ * next generation.
+ * By: Bradley Chao and Matthew Soto
+ * Date: 10/18/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "disassemble.h"
+
+typedef struct profile {
+        uint64_t *counts; /* Execution count per program counter */
+        uint64_t total;   /* Instructions executed in the chosen generation */
+} profile;
+
+typedef struct block_heat {
+        uint32_t index;
+        uint64_t entries;
+        uint64_t executed;
+} block_heat;
+
+static void read_profile(const char *path, unsigned generation,
+                         uint32_t length, profile *prof);
+static void print_block(const uint32_t *words, const Dis_block *block,
+                        uint32_t index, const profile *prof);
+static void print_hottest(const Dis_block *blocks, uint32_t num_blocks,
+                          const profile *prof, unsigned hottest);
+
+/* Name: main
+*  Purpose: Parse options, disassemble the program and print its blocks
+*  Parameters: argc, argv
+*  Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage
+*  Effects: Checked runtime error if the program or profile cannot be read
+*/
+int main(int argc, char *argv[])
+{
+        const char *profile_path = NULL;
+        unsigned generation = 0;
+        unsigned hottest = 10;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "p:g:n:")) != -1) {
+                switch (opt) {
+                        case 'p':
+                                profile_path = optarg;
+                                break;
+                        case 'g':
+                                generation = strtoul(optarg, NULL, 10);
+                                break;
+                        case 'n':
+                                hottest = strtoul(optarg, NULL, 10);
+                                break;
+                        default:
+                                fprintf(stderr, "Usage: %s [-p profile] "
+                                        "[-g generation] [-n hottest] "
+                                        "program.um\n", argv[0]);
+                                return EXIT_FAILURE;
+                }
+        }
+
+        if (optind != argc - 1) {
+                fprintf(stderr, "Usage: %s [-p profile] [-g generation] "
+                        "[-n hottest] program.um\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        FILE *fp = fopen(argv[optind], "rb");
+        assert(fp != NULL);
+
+        uint32_t length;
+        uint32_t *words = Dis_read_image(fp, &length);
+        fclose(fp);
+
+        uint32_t num_blocks;
+        Dis_block *blocks = Dis_find_blocks(words, length, &num_blocks);
+
+        profile prof = { NULL, 0 };
+        if (profile_path != NULL) {
+                read_profile(profile_path, generation, length, &prof);
+        }
+
+        printf("; %s: %" PRIu32 " words, %" PRIu32 " basic blocks\n",
+               argv[optind], length, num_blocks);
+
+        for (uint32_t i = 0; i < num_blocks; i++) {
+                print_block(words, &blocks[i], i, &prof);
+        }
+
+        if (prof.counts != NULL) {
+                print_hottest(blocks, num_blocks, &prof, hottest);
+                free(prof.counts);
+        }
+
+        free(blocks);
+        free(words);
+
+        return EXIT_SUCCESS;
+}
+
+/* Name: read_profile
+*  Purpose: Load the counts for one generation of a profile file
+*  Parameters: Path, generation wanted, program length, profile to fill in
+*  Returns: none
+*  Effects: Checked runtime error if the file cannot be opened. Counts for
+*           program counters beyond the image are added to the total only.
+*/
+static void read_profile(const char *path, unsigned generation,
+                         uint32_t length, profile *prof)
+{
+        FILE *fp = fopen(path, "r");
+        assert(fp != NULL);
+
+        prof->counts = calloc((size_t) length + 1, sizeof(uint64_t));
+        assert(prof->counts != NULL);
+        prof->total = 0;
+
+        char line[256];
+        while (fgets(line, sizeof(line), fp) != NULL) {
+                unsigned gen;
+                uint32_t pc;
+                uint64_t count;
+
+                if (line[0] == '#' ||
+                    sscanf(line, "%u %" SCNu32 " %" SCNu64,
+                           &gen, &pc, &count) != 3 ||
+                    gen != generation) {
+                        continue;
+                }
+
+                if (pc < length) {
+                        prof->counts[pc] += count;
+                }
+                prof->total += count;
+        }
+
+        fclose(fp);
+}
+
+/* Name: block_executed
+*  Purpose: Sum the counts of every word in a block
+*  Parameters: Block, profile
+*  Returns: Number of instructions executed inside the block
+*  Effects: none
+*/
+static uint64_t block_executed(const Dis_block *block, const profile *prof)
+{
+        uint64_t executed = 0;
+
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+                executed += prof->counts[pc];
+        }
+
+        return executed;
+}
+
+static double share(uint64_t part, uint64_t total)
+{
+        return total == 0 ? 0.0 : 100.0 * part / total;
+}
+
+/* Name: print_block
+*  Purpose: Print a block header, its words and where control goes next
+*  Parameters: Program words, block, block number, profile (may be empty)
+*  Returns: none
+*  Effects: Writes to stdout
+*/
+static void print_block(const uint32_t *words, const Dis_block *block,
+                        uint32_t index, const profile *prof)
+{
+        printf("\n; block %" PRIu32 " at %08" PRIx32 " (%" PRIu32 " words)",
+               index, block->start, block->end - block->start);
+
+        if (prof->counts != NULL) {
+                uint64_t executed = block_executed(block, prof);
+                printf("  count %" PRIu64 "  %.2f%%",
+                       prof->counts[block->start],
+                       share(executed, prof->total));
+        }
+        printf("\n");
+
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+                char assembly[64];
+                char meaning[64];
+
+                Dis_format(words[pc], assembly, sizeof(assembly));
+                Dis_describe(words[pc], meaning, sizeof(meaning));
+
+                printf("  %08" PRIx32 ":  %08" PRIx32 "  %-22s ; %s\n",
+                       pc, words[pc], assembly, meaning);
+        }
+
+        switch (block->exit) {
+                case DIS_FALLTHROUGH:
+                        printf("  ; falls through to %08" PRIx32 "\n",
+                               block->end);
+                        return;
+                case DIS_HALT:
+                        return;
+                case DIS_UNKNOWN_JUMP:
+                        printf("  ; -> unknown\n");
+                        return;
+                case DIS_FAR_JUMP:
+                        printf("  ; -> new segment zero at");
+                        break;
+                case DIS_JUMP:
+                        printf("  ; ->");
+                        break;
+        }
+
+        for (int i = 0; i < block->num_targets; i++) {
+                printf(" %08" PRIx32, block->targets[i]);
+        }
+        if (block->num_targets == 0) {
+                printf(" unknown");
+        }
+        printf("\n");
+}
+
+static int hotter(const void *a, const void *b)
+{
+        const block_heat *x = a;
+        const block_heat *y = b;
+
+        if (x->executed != y->executed) {
+                return x->executed < y->executed ? 1 : -1;
+        }
+        return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+/* Name: print_hottest
+*  Purpose: List the blocks that account for the most executed instructions
+*  Parameters: Blocks, number of blocks, profile, how many to list
+*  Returns: none
+*  Effects: Writes to stdout, checked runtime error if malloc fails
+*/
+static void print_hottest(const Dis_block *blocks, uint32_t num_blocks,
+                          const profile *prof, unsigned hottest)
+{
+        block_heat *heat = malloc((num_blocks + 1) * sizeof(block_heat));
+        assert(heat != NULL);
+
+        for (uint32_t i = 0; i < num_blocks; i++) {
+                heat[i].index = i;
+                heat[i].entries = prof->counts[blocks[i].start];
+                heat[i].executed = block_executed(&blocks[i], prof);
+        }
+
+        qsort(heat, num_blocks, sizeof(block_heat), hotter);
+
+        printf("\n; %" PRIu64 " instructions executed, hottest blocks:\n",
+               prof->total);
+        printf(";   %-8s %-10s %14s %14s %8s\n",
+               "block", "start", "entries", "instructions", "share");
+
+        for (uint32_t i = 0; i < num_blocks && i < hottest; i++) {
+                if (heat[i].executed == 0) {
+                        break;
+                }
+
+                printf(";   %-8" PRIu32 " %08" PRIx32 "   %14" PRIu64
+                       " %14" PRIu64 " %7.2f%%\n",
+                       heat[i].index, blocks[heat[i].index].start,
+                       heat[i].entries, heat[i].executed,
+                       share(heat[i].executed, prof->total));
+        }
+
+        free(heat);
+}
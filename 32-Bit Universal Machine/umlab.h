@@ -0,0 +1,70 @@
+/* Name: umlab.h
+ * Interface shared by the UM program writers (unit_tests.c and
+ * unit_benchmarks.c): the instruction word types and the functions that
+ * build and write streams of instructions
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef UMLAB_INCLUDED
+#define UMLAB_INCLUDED
+
+#include <stdint.h>
+#include <stdio.h>
+#include <seq.h>
+
+typedef uint32_t Um_instruction;
+typedef enum Um_opcode {
+        CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV,
+        NAND, HALT, ACTIVATE, INACTIVATE, OUT, IN, LOADP, LV,
+        BLOCK, BOUT     /* Extension, see instruction_set.h */
+} Um_opcode;
+
+typedef enum Um_register { r0 = 0, r1, r2, r3, r4, r5, r6, r7 } Um_register;
+
+/* Functions that return the two instruction types */
+Um_instruction three_register(Um_opcode op, int ra, int rb, int rc);
+Um_instruction loadval(unsigned ra, unsigned val);
+
+/* Wrapper functions for each of the instructions */
+Um_instruction conditional_move(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction segmented_load(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction segmented_store(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction addition(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction multiplication(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction division(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction bitwise_NAND(unsigned ra, unsigned rb, unsigned rc);
+Um_instruction map_segment(unsigned rb, unsigned rc);
+Um_instruction unmap_segment(unsigned rc);
+Um_instruction output(Um_register c);
+Um_instruction input(unsigned rc);
+Um_instruction load_program(unsigned rb, unsigned rc);
+
+/* The block extension: m[ra][rb..] := m[rd][re..] or rd for rc words, and
+ * output of rc words from m[ra][rb..] */
+Um_instruction block_copy(unsigned ra, unsigned rb, unsigned rc,
+                          unsigned rd, unsigned re);
+Um_instruction block_fill(unsigned ra, unsigned rb, unsigned rc,
+                          unsigned rd);
+Um_instruction output_block(unsigned ra, unsigned rb, unsigned rc);
+
+/* Writes the stream big-endian to output, emptying the stream */
+void Um_write_sequence(FILE *output, Seq_T stream);
+
+/* Benchmark builders (unit_benchmarks.c). Each program runs for roughly
+ * the given number of instructions; words sizes the segments it touches. */
+void build_bench_arith(Seq_T stream, uint64_t instructions, uint32_t words);
+void build_bench_sweep(Seq_T stream, uint64_t instructions, uint32_t words);
+void build_bench_churn_small(Seq_T stream, uint64_t instructions,
+                             uint32_t words);
+void build_bench_churn_mixed(Seq_T stream, uint64_t instructions,
+                             uint32_t words);
+void build_bench_churn_skewed(Seq_T stream, uint64_t instructions,
+                              uint32_t words);
+void build_bench_churn_large(Seq_T stream, uint64_t instructions,
+                             uint32_t words);
+void build_bench_far_jump(Seq_T stream, uint64_t instructions,
+                          uint32_t words);
+void build_bench_output(Seq_T stream, uint64_t instructions, uint32_t words);
+
+#endif
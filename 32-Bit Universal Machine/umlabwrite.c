@@ -23,6 +23,7 @@ extern void build_unmap(Seq_T stream);
 extern void build_load_program(Seq_T stream);
 extern void build_loop(Seq_T stream);
 extern void build_miscellaneous(Seq_T stream);
+extern void build_block(Seq_T stream);
 
 /* The array `tests` contains all unit tests for the lab. */
 
@@ -47,7 +48,8 @@ static struct test_info {
         { "build_unmap", NULL, "", build_unmap },
         { "build_load_program", NULL, "", build_load_program },
         { "build_loop", NULL, "", build_loop},
-        { "build_miscellaneous", NULL, "", build_miscellaneous }
+        { "build_miscellaneous", NULL, "", build_miscellaneous },
+        { "build_block", NULL, "BBAAAAA\n", build_block }
 
 };
   
@@ -0,0 +1,140 @@
+/* Name: umtrace.c
+ * Purpose: umtrace prints the tail of a trace ring dumped by um -T: the
+ * last instructions the program executed, oldest first, each with its
+ * program counter, word, mnemonic and the registers it named as they were
+ * before it ran. The last line is the instruction that was running when
+ * the ring was dumped, usually the one that failed.
+ *
+ * Usage: umtrace [-n count] trace
+ * By: Bradley Chao and Matthew Soto
+ * Date: 10/18/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "disassemble.h"
+#include "trace_ring.h"
+
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-n count] trace\n", program);
+        exit(EXIT_FAILURE);
+}
+
+/* Name: print_entry
+*  Purpose: Print one traced instruction
+*  Parameters: Its number in the run, the entry
+*  Returns: none
+*  Effects: Register values are shown only for the registers the
+*           instruction reads, and only rA, rB and rC of a block operation
+*           (the ring keeps no others)
+*/
+static void print_entry(uint64_t number, const Trace_entry *entry)
+{
+        char assembly[64];
+        char registers[64] = "";
+        Dis_format(entry->word, assembly, sizeof(assembly));
+
+        switch (entry->word >> 28) {
+                case 0: case 1: case 2: case 3: case 4: case 5: case 6:
+                case 14: case 15:
+                        snprintf(registers, sizeof(registers), "rA=%08" PRIx32
+                                 "  rB=%08" PRIx32 "  rC=%08" PRIx32,
+                                 entry->a, entry->b, entry->c);
+                        break;
+                case 8: case 12:
+                        snprintf(registers, sizeof(registers), "rB=%08" PRIx32
+                                 "  rC=%08" PRIx32, entry->b, entry->c);
+                        break;
+                case 9: case 10: case 11:
+                        snprintf(registers, sizeof(registers), "rC=%08" PRIx32,
+                                 entry->c);
+                        break;
+                default:
+                        /* HALT, LOAD_VALUE and invalid words read none */
+                        break;
+        }
+
+        printf("%12" PRIu64 "  %08" PRIx32 "  %08" PRIx32 "  ", number,
+               entry->pc, entry->word);
+        if (registers[0] == '\0') {
+                printf("%s\n", assembly);
+        }
+        else {
+                printf("%-24s  %s\n", assembly, registers);
+        }
+}
+
+/* Name: main
+*  Purpose: Read a trace dump and print its last entries
+*  Parameters: argc, argv
+*  Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage or a bad file
+*  Effects: Checked runtime error if the file cannot be read
+*/
+int main(int argc, char *argv[])
+{
+        uint64_t wanted = 32;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "n:")) != -1) {
+                switch (opt) {
+                        case 'n':
+                                wanted = strtoull(optarg, NULL, 10);
+                                break;
+                        default:
+                                usage(argv[0]);
+                }
+        }
+
+        if (optind != argc - 1) {
+                usage(argv[0]);
+        }
+
+        FILE *fp = fopen(argv[optind], "rb");
+        assert(fp != NULL);
+
+        Trace_header header;
+        if (fread(&header, sizeof(header), 1, fp) != 1 ||
+            header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+            header.byte_order != TRACE_BYTE_ORDER ||
+            header.entry_size != sizeof(Trace_entry) ||
+            header.capacity == 0 ||
+            (header.capacity & (header.capacity - 1)) != 0) {
+                fprintf(stderr, "%s: %s is not a trace dump from this "
+                        "machine\n", argv[0], argv[optind]);
+                return EXIT_FAILURE;
+        }
+
+        Trace_entry *entries = malloc((size_t) header.capacity *
+                                      sizeof(Trace_entry));
+        assert(entries != NULL);
+        size_t got = fread(entries, sizeof(Trace_entry), header.capacity, fp);
+        assert(got == header.capacity);
+        fclose(fp);
+
+        uint64_t kept = header.count < header.capacity ? header.count
+                                                       : header.capacity;
+        if (wanted > kept) {
+                wanted = kept;
+        }
+
+        printf("# %" PRIu64 " instructions executed, ring of %" PRIu32,
+               header.count, header.capacity);
+        if (header.reason != 0) {
+                printf(", dumped on %s", strsignal(header.reason));
+        }
+        printf("\n#%11s  %-8s  %-8s  %-24s  registers before\n", "number",
+               "pc", "word", "instruction");
+
+        for (uint64_t n = header.count - wanted; n < header.count; n++) {
+                print_entry(n, &entries[n & (header.capacity - 1)]);
+        }
+
+        free(entries);
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/* Name: umx_cache.c
+ * This module spares each UM process from byte-swapping its program into
+ * private heap memory. The first run of a program writes a .umx file, a
+ * header followed by the words in native byte order, and later runs map
+ * that file MAP_PRIVATE. The files live in a cache directory of their own
+ * rather than next to the programs, which may be in source or test trees:
+ * $UM_CACHE_DIR, else $XDG_CACHE_HOME/um, else $HOME/.cache/um. Segment zero's pages are then shared read-only by
+ * every process running the program, and copied only where one of them
+ * stores into segment zero. The header records the source file's size and
+ * modification time, so an edited program is recompiled, and a checksum of
+ * the words, so a damaged cache is never run.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "umx_cache.h"
+
+#define UMX_MAGIC 0x31584d55u           /* "UMX1" in little-endian order */
+#define UMX_VERSION 1
+#define UMX_BYTE_ORDER 0x01020304u      /* Reads differently if swapped */
+
+/* 64 bytes, ending with the length so that it sits right before words */
+typedef struct umx_header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t reserved;
+        uint64_t source_size;
+        int64_t source_mtime_sec;
+        int64_t source_mtime_nsec;
+        uint64_t checksum;              /* FNV-1a over the words */
+        uint32_t padding[3];
+        uint32_t length;
+} umx_header;
+
+static uint64_t checksum(const uint32_t *words, uint32_t length)
+{
+        uint64_t hash = 0xcbf29ce484222325u;
+
+        for (uint32_t i = 0; i < length; i++) {
+                hash ^= words[i];
+                hash *= 0x100000001b3u;
+        }
+
+        return hash;
+}
+
+static inline uint32_t *header_words(umx_header *header)
+{
+        return (uint32_t *) (header + 1);
+}
+
+/* Name: map_cache
+ * Purpose: Map a cache file if it is current for the source
+ * Parameters: Cache path, stat of the source, image to fill in
+ * Returns: true if image now holds the mapping
+ * Effects: Nothing is left mapped on failure
+ */
+static bool map_cache(const char *cache_path, const struct stat *source,
+                      Umx_image *image)
+{
+        int fd = open(cache_path, O_RDONLY);
+        if (fd < 0) {
+                return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 ||
+            (size_t) info.st_size < sizeof(umx_header)) {
+                close(fd);
+                return false;
+        }
+
+        size_t size = info.st_size;
+        void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                          fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+                return false;
+        }
+
+        umx_header *header = base;
+        uint32_t *words = header_words(header);
+
+        if (header->magic != UMX_MAGIC || header->version != UMX_VERSION ||
+            header->byte_order != UMX_BYTE_ORDER ||
+            header->source_size != (uint64_t) source->st_size ||
+            header->source_mtime_sec != source->st_mtim.tv_sec ||
+            header->source_mtime_nsec != source->st_mtim.tv_nsec ||
+            size != sizeof(umx_header) + (size_t) header->length * 4 ||
+            header->checksum != checksum(words, header->length)) {
+                munmap(base, size);
+                return false;
+        }
+
+        image->words = words;
+        image->length = header->length;
+        image->base = base;
+        image->size = size;
+        image->mapped = true;
+
+        return true;
+}
+
+/* Name: read_source
+ * Purpose: Read a big-endian program into a heap block laid out exactly
+ *          like a cache file
+ * Parameters: Source path, its stat
+ * Returns: Heap image (mapped is false)
+ * Effects: Checked runtime error if the file cannot be read or allocation
+ *          fails. Trailing bytes that do not make a whole word are ignored.
+ */
+static Umx_image read_source(const char *path, const struct stat *source)
+{
+        FILE *fp = fopen(path, "rb");
+        assert(fp != NULL);
+
+        size_t bytes = source->st_size;
+        uint32_t length = bytes / 4;
+        size_t size = sizeof(umx_header) + (size_t) length * 4;
+
+        umx_header *header = malloc(size);
+        assert(header != NULL);
+        memset(header, 0, sizeof(*header));
+
+        unsigned char *raw = (unsigned char *) header_words(header);
+        size_t got = fread(raw, 1, (size_t) length * 4, fp);
+        assert(got == (size_t) length * 4);
+        fclose(fp);
+
+        uint32_t *words = header_words(header);
+        for (uint32_t i = 0; i < length; i++) {
+                const unsigned char *b = raw + 4 * (size_t) i;
+                words[i] = (uint32_t) b[0] << 24 | (uint32_t) b[1] << 16 |
+                           (uint32_t) b[2] << 8 | b[3];
+        }
+
+        header->magic = UMX_MAGIC;
+        header->version = UMX_VERSION;
+        header->byte_order = UMX_BYTE_ORDER;
+        header->source_size = source->st_size;
+        header->source_mtime_sec = source->st_mtim.tv_sec;
+        header->source_mtime_nsec = source->st_mtim.tv_nsec;
+        header->checksum = checksum(words, length);
+        header->length = length;
+
+        Umx_image image = { words, length, header, size, false };
+        return image;
+}
+
+/* Name: write_cache
+ * Purpose: Publish a heap image as the cache file
+ * Parameters: Cache path, image from read_source
+ * Returns: true if the cache file was replaced
+ * Effects: Writes a private temporary file and renames it into place, so
+ *          concurrent runs never map a partial cache
+ */
+static bool write_cache(const char *cache_path, const Umx_image *image)
+{
+        char temp_path[4096];
+        if (snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", cache_path,
+                     (long) getpid()) >= (int) sizeof(temp_path)) {
+                return false;
+        }
+
+        int fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+                return false;
+        }
+
+        const unsigned char *bytes = image->base;
+        size_t left = image->size;
+        while (left > 0) {
+                ssize_t written = write(fd, bytes, left);
+                if (written < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (written <= 0) {
+                        close(fd);
+                        unlink(temp_path);
+                        return false;
+                }
+                bytes += written;
+                left -= written;
+        }
+
+        if (close(fd) != 0 || rename(temp_path, cache_path) != 0) {
+                unlink(temp_path);
+                return false;
+        }
+
+        return true;
+}
+
+/* Name: cache_path_for
+ * Purpose: Name the cache file of a program
+ * Parameters: Program path, buffer for the cache path and its size
+ * Returns: false if there is no cache directory or the name does not fit
+ * Effects: Creates the cache directory if needed. The file is named for
+ *          the program's base name and a hash of its absolute path, so
+ *          programs of the same name in different places do not collide.
+ */
+static bool cache_path_for(const char *path, char *cache_path, size_t size)
+{
+        char directory[4096];
+        const char *from = getenv("UM_CACHE_DIR");
+        const char *xdg = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        int length;
+
+        if (from != NULL && from[0] != '\0') {
+                length = snprintf(directory, sizeof(directory), "%s", from);
+        }
+        else if (xdg != NULL && xdg[0] != '\0') {
+                mkdir(xdg, 0755);
+                length = snprintf(directory, sizeof(directory), "%s/um", xdg);
+        }
+        else if (home != NULL && home[0] != '\0') {
+                length = snprintf(directory, sizeof(directory), "%s/.cache",
+                                  home);
+                mkdir(directory, 0755);
+                length = snprintf(directory, sizeof(directory),
+                                  "%s/.cache/um", home);
+        }
+        else {
+                return false;
+        }
+        if (length >= (int) sizeof(directory) ||
+            (mkdir(directory, 0755) != 0 && errno != EEXIST)) {
+                return false;
+        }
+
+        char *absolute = realpath(path, NULL);
+        if (absolute == NULL) {
+                return false;
+        }
+
+        uint64_t hash = 0xcbf29ce484222325u;
+        for (const char *c = absolute; *c != '\0'; c++) {
+                hash ^= (unsigned char) *c;
+                hash *= 0x100000001b3u;
+        }
+
+        const char *slash = strrchr(absolute, '/');
+        length = snprintf(cache_path, size, "%s/%s-%016llx.umx", directory,
+                          slash != NULL ? slash + 1 : absolute,
+                          (unsigned long long) hash);
+        free(absolute);
+
+        return length < (int) size;
+}
+
+/* Name: Umx_load
+ * Purpose: Load a program, mapping its .umx cache when possible
+ * Parameters: Path of the big-endian program
+ * Returns: Image whose words the caller releases with Umx_release
+ * Effects: May create or replace the program's file in the cache
+ *          directory. Checked runtime error if the program cannot be read.
+ */
+Umx_image Umx_load(const char *path)
+{
+        assert(path != NULL);
+
+        struct stat source;
+        int found = stat(path, &source);
+        assert(found == 0);
+
+        char cache_path[4096];
+        bool use_cache = getenv("UM_NO_UMX") == NULL &&
+                         cache_path_for(path, cache_path, sizeof(cache_path));
+
+        Umx_image image;
+        if (use_cache && map_cache(cache_path, &source, &image)) {
+                return image;
+        }
+
+        image = read_source(path, &source);
+
+        if (use_cache && write_cache(cache_path, &image)) {
+                Umx_image mapped;
+                if (map_cache(cache_path, &source, &mapped)) {
+                        free(image.base);
+                        return mapped;
+                }
+        }
+
+        return image;
+}
+
+/* Name: Umx_release
+ * Purpose: Give back the memory holding an image's words
+ * Parameters: Image
+ * Returns: none
+ * Effects: image->words is NULL afterwards
+ */
+void Umx_release(Umx_image *image)
+{
+        assert(image != NULL);
+
+        if (image->base != NULL) {
+                if (image->mapped) {
+                        munmap(image->base, image->size);
+                }
+                else {
+                        free(image->base);
+                }
+        }
+
+        image->words = NULL;
+        image->base = NULL;
+        image->size = 0;
+}
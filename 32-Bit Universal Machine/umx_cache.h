@@ -0,0 +1,35 @@
+/* Name: umx_cache.h
+ * Interface for umx_cache.c, which loads UM programs through a cache of
+ * native-endian images (.umx files in $UM_CACHE_DIR, $XDG_CACHE_HOME/um or
+ * $HOME/.cache/um) that processes map instead of read
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef UMX_CACHE_INCLUDED
+#define UMX_CACHE_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* A loaded program. words[-1] always holds length, so a UM that keeps a
+ * segment's length in front of its words can use words - 1 directly. */
+typedef struct Umx_image {
+        uint32_t *words;        /* Program words in native byte order */
+        uint32_t length;        /* Number of words */
+        void *base;             /* Mapping or heap block holding words */
+        size_t size;            /* Bytes at base */
+        bool mapped;            /* base is a MAP_PRIVATE mapping of a .umx */
+} Umx_image;
+
+/* Load the big-endian program at path, through its .umx file when the
+ * cache is current, creating or refreshing it otherwise. Falls back to a heap
+ * copy if the cache cannot be written or the environment variable
+ * UM_NO_UMX is set. */
+Umx_image Umx_load(const char *path);
+
+/* Unmap or free the image's words */
+void Umx_release(Umx_image *image);
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ * unit_benchmarks.c
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ *
+ * Builders for the UM stress programs written by umbenchwrite. Each one
+ * spends nearly all of its time in a single interpreter subsystem
+ * (arithmetic, segment loads and stores, map/unmap, LOAD_PROGRAM, OUTPUT)
+ * and repeats its loop often enough to execute about the requested number
+ * of instructions.
+ *
+ * Register conventions shared by every benchmark:
+ *      r0      always 0 (segment zero, the B operand of in-segment jumps)
+ *      r7      always ~0, so ADD rX, rX, r7 decrements rX
+ *      r6      outer loop counter
+ *      r4, r5  scratch, clobbered by every loop back edge
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include <seq.h>
+#include "umlab.h"
+
+#define CHURN_SLOTS 64  /* Live segments kept by the churn benchmarks */
+
+typedef enum churn_sizes { SIZES_SMALL, SIZES_MIXED, SIZES_SKEWED,
+                           SIZES_LARGE } churn_sizes;
+
+/* Instructions next_size appends after the generator step, per
+ * distribution, so the churn loop length is known before it is built */
+static const unsigned size_instructions[] = { 3, 2, 3, 1 };
+
+/* Functions for working with streams */
+
+static inline void append(Seq_T stream, Um_instruction inst)
+{
+        assert(sizeof(inst) <= sizeof(uintptr_t));
+        Seq_addhi(stream, (void *) (uintptr_t)inst);
+}
+
+static inline uint32_t here(Seq_T stream)
+{
+        return Seq_length(stream);
+}
+
+/* Name: load_constant
+ * Purpose: Put any 32-bit value in a register, with one LOAD_VALUE when it
+ *          fits in 25 bits and a multiply-add through r4 otherwise
+ * Parameters: Stream, register (not r4), value
+ * Returns: none
+ * Effects: Clobbers r4 for large values
+ */
+static void load_constant(Seq_T stream, Um_register reg, uint32_t value)
+{
+        if (value < (1u << 25)) {
+                append(stream, loadval(reg, value));
+                return;
+        }
+
+        assert(reg != r4);
+        append(stream, loadval(reg, value >> 16));
+        append(stream, loadval(r4, 1u << 16));
+        append(stream, multiplication(reg, reg, r4));
+        append(stream, loadval(r4, value & 0xffff));
+        append(stream, addition(reg, reg, r4));
+}
+
+/* Name: loop_back
+ * Purpose: Jump to top while counter is nonzero, otherwise fall through
+ * Parameters: Stream, segment to jump into (r0 for an ordinary branch),
+ *             counter register, address of the top of the loop
+ * Returns: none
+ * Effects: Appends four instructions that clobber r4 and r5
+ */
+static void loop_back(Seq_T stream, Um_register segment, Um_register counter,
+                      uint32_t top)
+{
+        uint32_t exit = here(stream) + 4;
+
+        append(stream, loadval(r5, exit));
+        append(stream, loadval(r4, top));
+        append(stream, conditional_move(r5, r4, counter));
+        append(stream, load_program(segment, r5));
+}
+
+/* Name: iterations
+ * Purpose: How many times a loop runs to execute about the requested
+ *          number of instructions
+ * Parameters: Instructions wanted, instructions per iteration
+ * Returns: Iteration count, at least one and at most 2^32 - 1
+ * Effects: none
+ */
+static uint32_t iterations(uint64_t instructions, uint64_t per_iteration)
+{
+        uint64_t count = instructions / per_iteration;
+
+        if (count == 0) {
+                return 1;
+        }
+        return count > UINT32_MAX ? UINT32_MAX : (uint32_t) count;
+}
+
+static void start(Seq_T stream)
+{
+        append(stream, bitwise_NAND(r7, r0, r0));
+}
+
+static void finish(Seq_T stream)
+{
+        append(stream, three_register(HALT, 0, 0, 0));
+}
+
+/* Arithmetic: a dependent chain of ADD, MUL, NAND and DIV */
+
+void build_bench_arith(Seq_T stream, uint64_t instructions, uint32_t words)
+{
+        (void) words;
+        const unsigned unroll = 4;
+
+        start(stream);
+        append(stream, loadval(r1, 1));
+        append(stream, loadval(r2, 3));
+        append(stream, loadval(r3, 7));
+        load_constant(stream, r6, iterations(instructions, 4 * unroll + 5));
+
+        uint32_t top = here(stream);
+        for (unsigned i = 0; i < unroll; i++) {
+                append(stream, addition(r1, r1, r2));
+                append(stream, multiplication(r2, r2, r3));
+                append(stream, bitwise_NAND(r1, r1, r2));
+                append(stream, division(r2, r1, r3));
+        }
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r0, r6, top);
+
+        finish(stream);
+}
+
+/* Segment sweep: read-modify-write every word of one large segment, over
+ * and over. Offsets run from words down to 1 so the inner counter doubles
+ * as the offset. */
+
+void build_bench_sweep(Seq_T stream, uint64_t instructions, uint32_t words)
+{
+        const unsigned unroll = 4;
+
+        words = (words + unroll - 1) / unroll * unroll;
+        assert(words > 0 && words < (1u << 25));
+
+        start(stream);
+        append(stream, loadval(r3, words + 1));
+        append(stream, map_segment(r1, r3));
+
+        uint64_t per_sweep = (uint64_t) words / unroll * (4 * unroll + 4) + 6;
+        load_constant(stream, r6, iterations(instructions, per_sweep));
+
+        uint32_t outer = here(stream);
+        append(stream, loadval(r2, words));
+
+        uint32_t inner = here(stream);
+        for (unsigned i = 0; i < unroll; i++) {
+                append(stream, segmented_load(r3, r1, r2));
+                append(stream, addition(r3, r3, r2));
+                append(stream, segmented_store(r1, r2, r3));
+                append(stream, addition(r2, r2, r7));
+        }
+        loop_back(stream, r0, r2, inner);
+
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r0, r6, outer);
+
+        finish(stream);
+}
+
+/* Name: slot_of_counter
+ * Purpose: r2 := r6 mod CHURN_SLOTS, with two NANDs making an AND
+ * Parameters: Stream
+ * Returns: none
+ * Effects: Clobbers r4
+ */
+static void slot_of_counter(Seq_T stream)
+{
+        append(stream, loadval(r4, CHURN_SLOTS - 1));
+        append(stream, bitwise_NAND(r4, r6, r4));
+        append(stream, bitwise_NAND(r2, r4, r4));
+}
+
+/* Name: next_size
+ * Purpose: Step the generator in r3 and leave a segment size in r4
+ * Parameters: Stream, size distribution, size for SIZES_LARGE
+ * Returns: none
+ * Effects: Clobbers r5. Sizes are 0-15 words (small), 0-4095 (mixed),
+ *          the square of 0-255 (skewed toward small, up to 65025) or
+ *          always words (large)
+ */
+static void next_size(Seq_T stream, churn_sizes sizes, uint32_t words)
+{
+        /* r3 := r3 * 1664525 + 12345 (mod 2^32), full period */
+        append(stream, loadval(r4, 1664525));
+        append(stream, multiplication(r3, r3, r4));
+        append(stream, loadval(r4, 12345));
+        append(stream, addition(r3, r3, r4));
+
+        switch (sizes) {
+                case SIZES_SMALL:
+                        /* 2^28 does not fit in LOAD_VALUE, shift twice */
+                        append(stream, loadval(r5, 1u << 14));
+                        append(stream, division(r4, r3, r5));
+                        append(stream, division(r4, r4, r5));
+                        break;
+                case SIZES_MIXED:
+                        append(stream, loadval(r4, 1u << 20));
+                        append(stream, division(r4, r3, r4));
+                        break;
+                case SIZES_SKEWED:
+                        append(stream, loadval(r4, 1u << 24));
+                        append(stream, division(r4, r3, r4));
+                        append(stream, multiplication(r4, r4, r4));
+                        break;
+                case SIZES_LARGE:
+                        assert(words < (1u << 25));
+                        append(stream, loadval(r4, words));
+                        break;
+        }
+}
+
+/* Map/unmap churn: a table segment holds CHURN_SLOTS live segment IDs.
+ * Every iteration unmaps the segment in one slot and maps a replacement
+ * whose size is drawn from the chosen distribution. */
+
+static void build_churn(Seq_T stream, uint64_t instructions, uint32_t words,
+                        churn_sizes sizes)
+{
+        start(stream);
+        append(stream, loadval(r3, CHURN_SLOTS));
+        append(stream, map_segment(r1, r3));
+
+        /* Fill the table with one-word segments */
+        append(stream, loadval(r6, CHURN_SLOTS));
+        uint32_t fill = here(stream);
+        slot_of_counter(stream);
+        append(stream, loadval(r4, 1));
+        append(stream, map_segment(r4, r4));
+        append(stream, segmented_store(r1, r2, r4));
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r0, r6, fill);
+
+        append(stream, loadval(r3, 1));
+        load_constant(stream, r6,
+                      iterations(instructions, 16 + size_instructions[sizes]));
+
+        uint32_t top = here(stream);
+        slot_of_counter(stream);
+        append(stream, segmented_load(r4, r1, r2));
+        append(stream, unmap_segment(r4));
+        next_size(stream, sizes, words);
+        append(stream, map_segment(r4, r4));
+        append(stream, segmented_store(r1, r2, r4));
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r0, r6, top);
+
+        finish(stream);
+}
+
+void build_bench_churn_small(Seq_T stream, uint64_t instructions,
+                             uint32_t words)
+{
+        build_churn(stream, instructions, words, SIZES_SMALL);
+}
+
+void build_bench_churn_mixed(Seq_T stream, uint64_t instructions,
+                             uint32_t words)
+{
+        build_churn(stream, instructions, words, SIZES_MIXED);
+}
+
+void build_bench_churn_skewed(Seq_T stream, uint64_t instructions,
+                              uint32_t words)
+{
+        build_churn(stream, instructions, words, SIZES_SKEWED);
+}
+
+void build_bench_churn_large(Seq_T stream, uint64_t instructions,
+                             uint32_t words)
+{
+        build_churn(stream, instructions, words, SIZES_LARGE);
+}
+
+/* Far jumps: copy segment zero into a new segment (padded to words), then
+ * loop with LOAD_PROGRAM from that segment, so every back edge duplicates
+ * the whole program. */
+
+void build_bench_far_jump(Seq_T stream, uint64_t instructions, uint32_t words)
+{
+        start(stream);
+        uint32_t size_at = here(stream);
+        append(stream, loadval(r3, 0)); /* patched with the padded size */
+        append(stream, map_segment(r1, r3));
+        append(stream, addition(r2, r3, r0));
+
+        uint32_t copy = here(stream);
+        append(stream, addition(r2, r2, r7));
+        append(stream, segmented_load(r3, r0, r2));
+        append(stream, segmented_store(r1, r2, r3));
+        loop_back(stream, r0, r2, copy);
+
+        load_constant(stream, r6, iterations(instructions, 5));
+
+        uint32_t top = here(stream);
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r1, r6, top);
+
+        finish(stream);
+
+        uint32_t size = here(stream) > words ? here(stream) : words;
+        assert(size < (1u << 25));
+        while (here(stream) < size) {
+                append(stream, 0);
+        }
+        Seq_put(stream, size_at, (void *) (uintptr_t) loadval(r3, size));
+}
+
+/* Output flood: lines of 63 characters */
+
+void build_bench_output(Seq_T stream, uint64_t instructions, uint32_t words)
+{
+        (void) words;
+        const unsigned line = 64;
+
+        start(stream);
+        append(stream, loadval(r2, 'u'));
+        append(stream, loadval(r3, '\n'));
+        load_constant(stream, r6, iterations(instructions, line + 5));
+
+        uint32_t top = here(stream);
+        for (unsigned i = 0; i < line - 1; i++) {
+                append(stream, output(r2));
+        }
+        append(stream, output(r3));
+        append(stream, addition(r6, r6, r7));
+        loop_back(stream, r0, r6, top);
+
+        finish(stream);
+}
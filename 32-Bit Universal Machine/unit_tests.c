@@ -18,17 +18,7 @@
 #include <assert.h>
 #include <seq.h>
 #include <bitpack.h>
-
-typedef uint32_t Um_instruction;
-typedef enum Um_opcode {
-        CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV,
-        NAND, HALT, ACTIVATE, INACTIVATE, OUT, IN, LOADP, LV
-} Um_opcode;
-
-
-/* Functions that return the two instruction types */
-Um_instruction three_register(Um_opcode op, int ra, int rb, int rc);
-Um_instruction loadval(unsigned ra, unsigned val);
+#include "umlab.h"
 
 
 /* Wrapper functions for each of the instructions */
@@ -37,8 +27,6 @@ static inline Um_instruction halt(void)
         return three_register(HALT, 0, 0, 0);
 }
 
-typedef enum Um_register { r0 = 0, r1, r2, r3, r4, r5, r6, r7 } Um_register;
-
 static inline Um_instruction add(Um_register a, Um_register b, Um_register c)
 {
         return three_register(ADD, a, b, c);
@@ -162,6 +150,32 @@ Um_instruction load_program(unsigned rb, unsigned rc)
         return three_register(LOADP, 0, rb, rc);
 }
 
+Um_instruction block_copy(unsigned ra, unsigned rb, unsigned rc,
+                          unsigned rd, unsigned re)
+{
+        Um_instruction ret = three_register(BLOCK, ra, rb, rc);
+
+        ret = Bitpack_newu(ret, 3, 9, rd);
+        ret = Bitpack_newu(ret, 3, 12, re);
+
+        return Bitpack_newu(ret, 3, 25, 0);
+}
+
+Um_instruction block_fill(unsigned ra, unsigned rb, unsigned rc,
+                          unsigned rd)
+{
+        Um_instruction ret = three_register(BLOCK, ra, rb, rc);
+
+        ret = Bitpack_newu(ret, 3, 9, rd);
+
+        return Bitpack_newu(ret, 3, 25, 1);
+}
+
+Um_instruction output_block(unsigned ra, unsigned rb, unsigned rc)
+{
+        return three_register(BOUT, ra, rb, rc);
+}
+
 /* Unit tests for the UM */
 
 void build_halt_test(Seq_T stream)
@@ -482,3 +496,31 @@ void build_miscellaneous(Seq_T stream)
         append(stream, halt());
 }
 
+void build_block(Seq_T stream)
+{
+        /* Two segments of 8 words */
+        append(stream, loadval(r2, 8));
+        append(stream, map_segment(r1, r2));
+        append(stream, map_segment(r7, r2));
+
+        /* Fill the first with 'A', then put a 'B' at the front */
+        append(stream, loadval(r3, 0));
+        append(stream, loadval(r4, 'A'));
+        append(stream, block_fill(r1, r3, r2, r4));
+        append(stream, loadval(r6, 'B'));
+        append(stream, segmented_store(r1, r3, r6));
+
+        /* Shift the first 7 words up by one, an overlapping copy which
+           must read every word before writing: "BBAAAAAA" */
+        append(stream, loadval(r0, 1));
+        append(stream, loadval(r5, 7));
+        append(stream, block_copy(r1, r0, r5, r1, r3));
+        append(stream, loadval(r6, '\n'));
+        append(stream, segmented_store(r1, r5, r6));
+
+        /* Copy to the second segment and print it all at once */
+        append(stream, block_copy(r7, r3, r2, r1, r3));
+        append(stream, output_block(r7, r3, r2));
+
+        append(stream, halt());
+}
@@ -6,20 +6,87 @@
  * November 18, 2022
  */
 
+#include <string.h>
 #include "universal_machine.h"
+#include "bulk_memory.h"
+
+/* Name: reset_segment_cache
+*  Purpose: Give segment zero's current code an empty inline cache
+*  Parameters: UM, number of words in segment zero
+*  Returns: none
+*  Effects: Frees the old cache, checked runtime error if allocation fails
+*/
+static void reset_segment_cache(universal_machine UM, uint32_t length)
+{
+        free(UM->segment_cache);
+
+        /* An entry with a null segment is empty */
+        UM->segment_cache = calloc((size_t) length + 1,
+                                   sizeof(segment_cache_entry));
+        assert(UM->segment_cache != NULL);
+
+        UM->segment_cache_length = length;
+}
+
+/* Name: cached_segment
+*  Purpose: Find the mapped segment ID names for the load or store at the
+*           program counter, trying that instruction's inline cache first
+*  Parameters: UM, segment ID
+*  Returns: The segment
+*  Effects: Checked runtime error if ID is out of bounds or unmapped. A
+*           miss refills the entry.
+*
+*  An ID keeps the same segment struct for the life of the UM, so MAP and
+*  UNMAP never make an entry point at the wrong segment, only at one whose
+*  valid flag is now clear, which a hit checks anyway. LOAD_PROGRAM replaces
+*  the code the entries describe and starts a new cache.
+*/
+static inline segment cached_segment(universal_machine UM, uint32_t ID)
+{
+        uint32_t pc = UM->program_counter;
+        segment_cache_entry *entry = NULL;
+
+        UM->cache_lookups++;
+
+        if (pc < UM->segment_cache_length) {
+                entry = &UM->segment_cache[pc];
+                if (entry->ID == ID && entry->seg != NULL &&
+                    entry->seg->valid) {
+                        return entry->seg;
+                }
+        }
+
+        UM->cache_misses++;
+
+        /* (3) Check whether ID is within bounds of addressable segments */
+        assert(ID < (uint32_t) Seq_length(UM->segments));
+
+        segment seg = (segment) Seq_get(UM->segments, ID);
+
+        /* (7) If segment has not been mapped, checked runtime error */
+        assert(seg->valid);
+
+        if (entry != NULL) {
+                entry->ID = ID;
+                entry->seg = seg;
+        }
+
+        return seg;
+}
 
 /* Name: new_UM
 *  Purpose: create instance of universal machine
-*  Parameters: program_instructions
+*  Parameters: Malloced array of program words (the UM takes ownership),
+*              number of words
 *  Returns: universal machine
 *  Effects: creates object and checks 
-*           Checked runtime error if program_instructions, 
+*           Checked runtime error if program, 
 *           UM, or any of UM's fields are null
 *           
 */
-universal_machine new_UM(Seq_T program_instructions)
+universal_machine new_UM(UM_instruction *program, uint32_t length)
 {
-        assert(program_instructions != NULL);
+        assert(program != NULL);
 
         /* Allocate 56 bytes of space on heap */
         universal_machine UM = malloc(sizeof(*UM));
@@ -33,26 +100,105 @@ universal_machine new_UM(Seq_T program_instructions)
         /* Program counter starts at zero, allocate sequences */
         UM->program_counter = 0;
 
-        UM->unmapped_IDs = Seq_new(100);
+        /* Output goes straight to stdout until a client asks otherwise */
+        UM->output_ring = NULL;
+        UM->output_pages = NULL;
+        UM->input_fn = NULL;
+        UM->output_fn = NULL;
+        UM->io_closure = NULL;
+        UM->trace = NULL;
+        UM->strict = false;
+
+        /* The words are plain heap memory, not a loaded image */
+        UM->program_image.words = NULL;
+        UM->program_image.base = NULL;
+
+        UM->unmapped_IDs = Seq32_new(100);
         assert((UM->unmapped_IDs) != NULL);
 
         UM->segments = Seq_new(100);
         assert((UM->segments)!= NULL);
 
+        UM->segment_cache = NULL;
+        reset_segment_cache(UM, length);
+        UM->cache_lookups = 0;
+        UM->cache_misses = 0;
+        UM->steps_done = 0;
+        UM->slice_start = 0;
+
         /* Allocate segment zero on heap */
         segment segment_zero = malloc(sizeof(*segment_zero));
         assert(segment_zero != NULL);
 
         /* Segment zero has now been "mapped" */
         segment_zero->valid = true;
+        segment_zero->dirty = true;
 
-        segment_zero->instructions = program_instructions;
+        segment_zero->length = length;
+        segment_zero->words = program;
 
         Seq_addhi(UM->segments, (void *) segment_zero);
 
         return UM;
 }
 
+/* Name: new_UM_from_image
+*  Purpose: create instance of universal machine running a loaded image
+*  Parameters: Image from Umx_load (the UM takes ownership)
+*  Returns: universal machine
+*  Effects: Segment zero uses the image's words in place, which may be a
+*           shared mapping of a .umx cache
+*/
+universal_machine new_UM_from_image(Umx_image image)
+{
+        /* new_UM only needs a non-null pointer, the words are the image's */
+        universal_machine UM = new_UM(image.words, image.length);
+        UM->program_image = image;
+
+        return UM;
+}
+
+/* Name: release_segment_zero_words
+*  Purpose: Give back segment zero's words, unmapping them if they are
+*           still the loaded image
+*  Parameters: UM
+*  Returns: none
+*  Effects: segment zero's words pointer is left dangling
+*/
+static void release_segment_zero_words(universal_machine UM)
+{
+        segment segment_zero = (segment) Seq_get(UM->segments, 0);
+
+        if (UM->program_image.words != NULL &&
+            segment_zero->words == UM->program_image.words) {
+                Umx_release(&UM->program_image);
+        }
+        else {
+                free(segment_zero->words);
+        }
+}
+
+/* Name: replace_segment_zero
+*  Purpose: Make a malloced word array the new segment zero
+*  Parameters: UM, words (the UM takes ownership), number of words
+*  Returns: none
+*  Effects: The old words are freed or unmapped
+*/
+void replace_segment_zero(universal_machine UM, UM_instruction *words,
+                          uint32_t length)
+{
+        assert(UM != NULL && words != NULL);
+
+        release_segment_zero_words(UM);
+
+        segment segment_zero = (segment) Seq_get(UM->segments, 0);
+        segment_zero->length = length;
+        segment_zero->words = words;
+        segment_zero->dirty = true;
+
+        reset_segment_cache(UM, length);
+}
+
 /* Name: free_UM
  * Purpose: Frees heap allocated data associated with UM data structure
  * Parameters: Address of pointer to instance of UM
@@ -68,14 +214,15 @@ void free_UM(universal_machine *UM)
 
         for (int i = 0; i < Seq_length(stack_copy->segments); i++) {
 
-                /* Frees the instruction sequence member of segment struct
+                /* Frees the word array member of segment struct
                    Avoid double freeing by checking whether the segment has
                    been unmapped already */
                 segment target = (segment) Seq_get(stack_copy->segments, i);
-                if (target->valid) {
-                        Seq_free(&((
-                                (segment) Seq_get(stack_copy->segments, i))
-                                                        ->instructions));
+                if (i == 0) {
+                        release_segment_zero_words(stack_copy);
+                }
+                else if (target->valid) {
+                        free(target->words);
                 }
                 
                 /* Frees the malloced pointer to the segment struct */
@@ -83,11 +230,13 @@ void free_UM(universal_machine *UM)
         }
 
         /* Frees the sequence of 32-bit IDs */
-        Seq_free(&(stack_copy->unmapped_IDs));
+        Seq32_free(&(stack_copy->unmapped_IDs));
 
         /* Frees the container of the sequence of segments */
         Seq_free(&(stack_copy->segments));
 
+        free(stack_copy->segment_cache);
+
         /* Frees malloced pointer to the UM struct */
         free(stack_copy);
 }
@@ -103,27 +252,13 @@ UM_instruction get_instruction(universal_machine UM, uint32_t ID,
                                                         uint32_t offset)
 {
         assert(UM != NULL);
-        
-        /* (3) Check whether ID is within bounds of addressable segments */
-        assert(ID < (uint32_t) Seq_length(UM->segments));
-
-        /* Hanson assertion will occur if there is a get on allocated 
-           segment space but has not been initialized to value */
-        segment seg = (segment) Seq_get(UM->segments, ID);
 
-        /* (7) If segment has not been mapped, checked runtime error */
-        assert((seg->valid));
+        segment seg = cached_segment(UM, ID);
 
         /* (4) Check that the offset is within bounds of the segment */
-        assert(offset < (uint32_t) Seq_length(seg->instructions));
-
-        /* Implicit cast 32-bit uintptr_t to UM_instruction */
-        /* Hanson assertion will occur if get is called on allocated segment
-           which has not been allocated */
-        UM_instruction instruction = (uintptr_t) 
-                                        Seq_get(seg->instructions, offset);
+        assert(offset < seg->length);
 
-        return instruction;
+        return seg->words[offset];
 }
 
 /* Name: set_instruction
@@ -138,15 +273,97 @@ void set_instruction(universal_machine UM, uint32_t ID, uint32_t offset,
 {
         assert(UM != NULL);
 
+        segment seg = cached_segment(UM, ID);
+
+        assert(offset < seg->length);
+
+        seg->words[offset] = instruction;
+        seg->dirty = true;
+}
+
+/* Name: segment_range
+*  Purpose: Find the words count words long starting at offset in a mapped
+*           segment, for the block instructions
+*  Parameters: UM, segment ID, offset, number of words
+*  Returns: The segment
+*  Effects: Checked runtime error if ID is out of bounds or unmapped, or
+*           if any word of the range is outside the segment
+*/
+static segment segment_range(universal_machine UM, uint32_t ID,
+                             uint32_t offset, uint32_t count)
+{
         assert(ID < (uint32_t) Seq_length(UM->segments));
 
         segment seg = (segment) Seq_get(UM->segments, ID);
+        assert(seg->valid);
 
-        assert((seg->valid));
+        /* Written so that offset + count cannot wrap */
+        assert(offset <= seg->length && count <= seg->length - offset);
 
-        assert(offset < (uint32_t) Seq_length(seg->instructions));
+        return seg;
+}
 
-        Seq_put(seg->instructions, offset, (void *) (uintptr_t) instruction);
+/* Name: get_words
+*  Purpose: Give read access to count words of a segment
+*  Parameters: UM, segment ID, offset, number of words
+*  Returns: Pointer to the first word, valid until the next MAP, UNMAP or
+*           LOAD_PROGRAM
+*  Effects: Checked runtime error if the range is not all mapped
+*/
+const UM_instruction *get_words(universal_machine UM, uint32_t ID,
+                                uint32_t offset, uint32_t count)
+{
+        assert(UM != NULL);
+
+        return segment_range(UM, ID, offset, count)->words + offset;
+}
+
+/* Name: copy_words
+*  Purpose: $m[dst_ID][dst_offset + i] := $m[src_ID][src_offset + i] for
+*           every i < count, as though every word were read before any was
+*           written
+*  Parameters: UM, destination ID and offset, source ID and offset, count
+*  Returns: none
+*  Effects: Marks the destination dirty. Checked runtime error if either
+*           range is not all mapped.
+*/
+void copy_words(universal_machine UM, uint32_t dst_ID, uint32_t dst_offset,
+                uint32_t src_ID, uint32_t src_offset, uint32_t count)
+{
+        assert(UM != NULL);
+
+        segment src = segment_range(UM, src_ID, src_offset, count);
+        segment dst = segment_range(UM, dst_ID, dst_offset, count);
+
+        if (src == dst) {
+                /* The ranges may overlap */
+                memmove(dst->words + dst_offset, src->words + src_offset,
+                        (size_t) count * sizeof(UM_instruction));
+        }
+        else {
+                Bulk_copy32(dst->words + dst_offset, src->words + src_offset,
+                            count);
+        }
+
+        dst->dirty = true;
+}
+
+/* Name: fill_words
+*  Purpose: $m[ID][offset + i] := value for every i < count
+*  Parameters: UM, segment ID, offset, value, count
+*  Returns: none
+*  Effects: Marks the segment dirty. Checked runtime error if the range is
+*           not all mapped.
+*/
+void fill_words(universal_machine UM, uint32_t ID, uint32_t offset,
+                uint32_t value, uint32_t count)
+{
+        assert(UM != NULL);
+
+        segment seg = segment_range(UM, ID, offset, count);
+
+        Bulk_fill32(seg->words + offset, value, count);
+        seg->dirty = true;
 }
 
 /* Name: get_register
@@ -192,25 +409,25 @@ uint32_t map_segment(universal_machine UM, uint32_t segment_length)
 {
         assert(UM != NULL);
 
-        Seq_T new_instructions = Seq_new(segment_length);
-        assert(new_instructions != NULL);
+        /* Zero-length segments still get a unique, freeable pointer */
+        UM_instruction *new_words = malloc(((size_t) segment_length + 1) *
+                                           sizeof(UM_instruction));
+        assert(new_words != NULL);
 
         /* Initialize all word members to be zero */
-        UM_instruction zero_word = 0;
-
-        for (size_t i = 0; i < segment_length; i++) {
-                Seq_addhi(new_instructions, (void *) (uintptr_t) zero_word);
-        }
+        Bulk_fill32(new_words, 0, segment_length);
 
         /* Case 1: If there are no unmapped IDs */
-        if (Seq_length(UM->unmapped_IDs) == 0) {
+        if (Seq32_length(UM->unmapped_IDs) == 0) {
 
                 /* Allocate new segment with all words initialized to zero */
                 segment new_segment = malloc(sizeof(*new_segment));
                 assert(new_segment != NULL);
 
                 new_segment->valid = true;
-                new_segment->instructions = new_instructions;
+                new_segment->dirty = true;
+                new_segment->length = segment_length;
+                new_segment->words = new_words;
 
                 /* Enqueue the new segment */
                 Seq_addhi(UM->segments, (void *) new_segment);
@@ -221,16 +438,17 @@ uint32_t map_segment(universal_machine UM, uint32_t segment_length)
         /* Case 2: There are unmapped IDs available for use */
         else {
                 /* Dequeue next unmapped ID and map the new segment there */
-                uint32_t segment_ID = (uint32_t) (uintptr_t) 
-                                                Seq_remlo(UM->unmapped_IDs);
+                uint32_t segment_ID = Seq32_remlo(UM->unmapped_IDs);
 
                 segment to_replace = (segment) 
                                         Seq_get(UM->segments, segment_ID);
                 assert(to_replace != NULL);
 
                 to_replace->valid = true;
-                /* Delegated the freeing the instructions to unmap */
-                to_replace->instructions = new_instructions;
+                to_replace->dirty = true;
+                /* Delegated the freeing the words to unmap */
+                to_replace->length = segment_length;
+                to_replace->words = new_words;
 
                 return segment_ID;
         }
@@ -261,10 +479,12 @@ void unmap_segment(universal_machine UM, uint32_t segment_ID)
 
         /* Set boolean to false so user cannot re-access this location */
         unmapped_segment->valid = false;
+        unmapped_segment->dirty = true;
 
         /* Free the data associated with this segment */
-        Seq_free(&(unmapped_segment->instructions));
+        free(unmapped_segment->words);
+        unmapped_segment->words = NULL;
 
         /* This index in memory is no available for new use */
-        Seq_addhi(UM->unmapped_IDs, (void *) (uintptr_t) segment_ID);
+        Seq32_addhi(UM->unmapped_IDs, segment_ID);
 }
\ No newline at end of file
@@ -12,32 +12,80 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <seq.h>
+#include <seq32.h>
 #include <uarray.h>
 #include <assert.h>
 #include <stdbool.h>
+#include "async_output.h"
+#include "splice_output.h"
+#include "trace_ring.h"
+#include "umx_cache.h"
 
 typedef uint32_t UM_instruction;
 
+/* I/O device callbacks for embedding clients. An input function returns a
+ * byte (0-255) or EOF at the end of input. */
+typedef int (*UM_input_fn)(void *closure);
+typedef void (*UM_output_fn)(void *closure, unsigned char byte);
+
+/* Remembers which segment one SEGMENTED_LOAD/STORE used last time */
+typedef struct segment_cache_entry {
+        uint32_t ID;
+        struct segment *seg;
+} segment_cache_entry;
+
 typedef struct universal_machine {
         uint32_t registers[8]; /* pointer to first element */
         uint32_t program_counter;
-        Seq_T unmapped_IDs;
+        Seq32_T unmapped_IDs;
         Seq_T segments; /* UArray of segment */
+        Async_output output_ring; /* NULL unless output is asynchronous */
+        Splice_output output_pages; /* NULL unless output is spliced */
+        UM_input_fn input_fn;     /* NULL means stdin */
+        UM_output_fn output_fn;   /* NULL means stdout */
+        void *io_closure;         /* Passed to both callbacks */
+        Umx_image program_image;  /* Holds segment zero's words until the
+                                     first LOAD_PROGRAM replaces them */
+        segment_cache_entry *segment_cache; /* One entry per word of segment
+                                               zero, indexed by the PC */
+        uint32_t segment_cache_length;
+        uint64_t cache_lookups;
+        uint64_t cache_misses;
+        uint64_t steps_done;      /* Instructions run_steps had finished
+                                     when its current slice began */
+        uint32_t slice_start;     /* Program counter at that point */
+        Trace_ring *trace;        /* NULL unless instructions are traced */
+        bool strict;              /* Opcodes 14 and 15 are invalid, as the
+                                     spec has them */
 } *universal_machine;
 
 typedef struct segment {
         bool valid; /* Tracks whether the segment is valid/mapped */
-        Seq_T instructions;
+        bool dirty; /* Mapped, unmapped or stored into since the last
+                       checkpoint (see checkpoint.h) */
+        uint32_t length; /* Number of words */
+        UM_instruction *words; /* Flat array so bulk copies are one call */
 } *segment;
 
-universal_machine new_UM(Seq_T segment_zero);
+universal_machine new_UM(UM_instruction *program, uint32_t length);
+universal_machine new_UM_from_image(Umx_image image);
 void free_UM(universal_machine *UM);
+void replace_segment_zero(universal_machine UM, UM_instruction *words,
+                          uint32_t length);
 
 UM_instruction get_instruction(universal_machine UM, uint32_t ID,
                                  uint32_t offset);
 void set_instruction(universal_machine UM, uint32_t ID, uint32_t offset,
                          UM_instruction instruction);
 
+/* Ranges of words for the block instructions of instruction_set.h */
+const UM_instruction *get_words(universal_machine UM, uint32_t ID,
+                                uint32_t offset, uint32_t count);
+void copy_words(universal_machine UM, uint32_t dst_ID, uint32_t dst_offset,
+                uint32_t src_ID, uint32_t src_offset, uint32_t count);
+void fill_words(universal_machine UM, uint32_t ID, uint32_t offset,
+                uint32_t value, uint32_t count);
+
 uint32_t get_register(universal_machine UM, uint32_t register_ID);
 void set_register(universal_machine UM, uint32_t register_ID,
                  UM_instruction instruction);
@@ -0,0 +1,70 @@
+#! /bin/sh
+# Usage: bench/calc40.sh [-n bytes] [-r seed] [shape...]
+# Runs a script from rpngen of each shape (default: all of them) through
+# calc40, through calc40.um on the modular um and through calc40.um on the
+# Profiled UM, checks that the three outputs match and prints each one's
+# throughput in input bytes per second, with UM instructions per input
+# byte from um -s. Both UMs must have been built.
+cd "$(dirname "$0")/.." || exit 1
+um="../32-Bit Universal Machine/um"
+profiled="../32-Bit Universal Machine/Profiled UM/um"
+bytes=1000000
+seed=1
+
+while getopts n:r: option; do
+        case $option in
+                n) bytes=$OPTARG ;;
+                r) seed=$OPTARG ;;
+                *) exit 1 ;;
+        esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || set -- deep long print divide mixed
+
+for program in "$um" "$profiled"; do
+        [ -x "$program" ] || { echo "$program: not built" >&2; exit 1; }
+done
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+make -s calc40 umasm rpngen &&
+./umasm urt0.ums calc40.ums printd.ums callmain.ums > "$tmp/calc40.um" ||
+        exit 1
+
+# run name command... < input > $tmp/name.out, printing the nanoseconds
+run()
+{
+        name=$1
+        shift
+        start=$(date +%s%N)
+        "$@" < "$tmp/input" > "$tmp/$name.out" 2> "$tmp/$name.err" || {
+                echo "$name failed:" >&2
+                cat "$tmp/$name.err" >&2
+                exit 1
+        }
+        echo $(($(date +%s%N) - start))
+}
+
+printf "%-8s %10s %12s %12s %12s %10s\n" shape bytes "calc40 B/s" \
+       "um B/s" "profiled B/s" "instr/B"
+for shape in "$@"; do
+        ./rpngen -n "$bytes" -r "$seed" "$shape" > "$tmp/input" || exit 1
+        size=$(wc -c < "$tmp/input")
+
+        native=$(run native ./calc40) || exit 1
+        modular=$(run modular "$um" -s "$tmp/calc40.um") || exit 1
+        profiled_ns=$(run profiled "$profiled" "$tmp/calc40.um") || exit 1
+        instructions=$(sed -n 's/^um: \([0-9]*\) instructions$/\1/p' \
+                       "$tmp/modular.err")
+
+        for name in modular profiled; do
+                cmp -s "$tmp/native.out" "$tmp/$name.out" ||
+                        echo "$shape: $name output differs from calc40" >&2
+        done
+
+        awk -v s="$shape" -v b="$size" -v n="$native" -v m="$modular" \
+            -v p="$profiled_ns" -v i="$instructions" 'BEGIN {
+                printf "%-8s %10d %12.3g %12.3g %12.3g %10.1f\n", s, b,
+                       b * 1e9 / n, b * 1e9 / m, b * 1e9 / p, i / b }'
+done
@@ -0,0 +1,32 @@
+#! /bin/sh
+# Usage: bench/dispatch.sh input...
+# Assembles calc40.um with its jump tables and with bench/dispatch_chain.ums,
+# runs both on each input under um -s and prints UM instructions per input
+# byte. Outputs of the two versions are compared as well.
+cd "$(dirname "$0")/.." || exit 1
+um="../32-Bit Universal Machine/um"
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+./umasm urt0.ums calc40.ums printd.ums callmain.ums > "$tmp/table.um" &&
+./umasm urt0.ums calc40.ums bench/dispatch_chain.ums printd.ums callmain.ums \
+        > "$tmp/chain.um" || exit 1
+
+count()
+{
+        "$um" -s "$1" < "$2" > "$3" 2> "$tmp/stats" || exit 1
+        sed -n 's/^um: \([0-9]*\) instructions$/\1/p' "$tmp/stats"
+}
+
+printf "%-24s %10s %14s %14s %8s\n" input bytes "table instr/B" \
+       "chain instr/B" speedup
+for input in "$@"; do
+        bytes=$(wc -c < "$input")
+        table=$(count "$tmp/table.um" "$input" "$tmp/table.out")
+        chain=$(count "$tmp/chain.um" "$input" "$tmp/chain.out")
+        cmp -s "$tmp/table.out" "$tmp/chain.out" ||
+                echo "$input: outputs differ" >&2
+        awk -v n="$input" -v b="$bytes" -v t="$table" -v c="$chain" 'BEGIN {
+                printf "%-24s %10d %14.1f %14.1f %7.2fx\n", n, b, t / b,
+                       c / b, c / t }'
+done
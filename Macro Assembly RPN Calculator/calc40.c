@@ -4,33 +4,212 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
-
-#include <seq.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
 
 typedef uint32_t Um_word;
 
-/* make Seq_T into a stack of integers */
-static void push(Seq_T values, Um_word word) 
+/* the value stack: a growable array of words, bottom first */
+typedef struct Stack {
+        Um_word *words;
+        int length;
+        int capacity;
+} *Stack;
+
+static Stack Stack_new(int capacity)
+{
+        Stack stack = malloc(sizeof(*stack));
+        assert(stack != NULL);
+        stack->words = malloc(capacity * sizeof(Um_word));
+        assert(stack->words != NULL);
+        stack->length = 0;
+        stack->capacity = capacity;
+        return stack;
+}
+
+static void Stack_free(Stack *stack)
+{
+        free((*stack)->words);
+        free(*stack);
+        *stack = NULL;
+}
+
+/* double the capacity; the only call on the push path */
+static void grow(Stack stack)
+{
+        stack->capacity *= 2;
+        stack->words = realloc(stack->words,
+                               stack->capacity * sizeof(Um_word));
+        assert(stack->words != NULL);
+}
+
+static inline void push(Stack values, Um_word word) 
+{
+        if (values->length == values->capacity)
+                grow(values);
+        values->words[values->length++] = word;
+}
+
+static inline Um_word pop(Stack values)
 {
-        assert(sizeof(Um_word) <= sizeof(uintptr_t));
-        Seq_addhi(values, (void *)(uintptr_t) word);
+        return values->words[--values->length];
 }
 
-static Um_word pop(Seq_T values)
+/* address of the top value, which can be updated in place */
+static inline Um_word *peek(Stack values)
 {
-        return (Um_word)(uintptr_t) Seq_remhi(values);
+        return &values->words[values->length - 1];
 }
 
-static Um_word get(Seq_T values, int i)
+static inline Um_word get(Stack values, int i)
 {
-        return (Um_word)(uintptr_t) Seq_get(values, i);
+        return values->words[i];
+}
+
+/*
+ * Standard input is read in large blocks, and everything printed is
+ * collected in one buffer that goes out with a single write.  The buffer
+ * is written before the next read could block, so an interactive user
+ * sees each printed stack before typing more, and otherwise once it
+ * passes OUTPUT_FLUSH bytes.
+ *
+ * In batch mode each worker thread has its own input and output: the
+ * input is a session already in memory, and the output is kept until the
+ * main thread writes it (see run_batch).
+ */
+enum { INPUT_SIZE = 64 * 1024, OUTPUT_FLUSH = 64 * 1024 };
+
+/* longest line the calculator prints, ">>> -2147483648\n" or a message */
+enum { LINE_MAX_BYTES = 64 };
+
+static unsigned char input_buffer[INPUT_SIZE];
+
+static __thread const unsigned char *input;
+static __thread size_t input_next, input_end;
+static __thread bool in_memory; /* batch mode: no reads, no writes */
+
+static __thread char *output;
+static __thread size_t output_used, output_capacity;
+
+static void write_all(const char *bytes, size_t length)
+{
+        size_t done = 0;
+        while (done < length) {
+                ssize_t n = write(STDOUT_FILENO, bytes + done, length - done);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        break; /* like printf, drop output nobody can take */
+                }
+                done += n;
+        }
+}
+
+static void flush_output(void)
+{
+        if (in_memory)
+                return;
+        write_all(output, output_used);
+        output_used = 0;
+}
+
+/* make room for n more bytes of output */
+static void reserve_output(size_t n)
+{
+        if (output_used + n <= output_capacity)
+                return;
+        while (output_used + n > output_capacity)
+                output_capacity = output_capacity ? 2 * output_capacity
+                                                  : 2 * OUTPUT_FLUSH;
+        output = realloc(output, output_capacity);
+        assert(output != NULL);
+}
+
+/* refill the input buffer; the only call on the next_char path */
+static int refill_input(void)
+{
+        if (in_memory)
+                return EOF;
+        flush_output();
+        for (;;) {
+                ssize_t n = read(STDIN_FILENO, input_buffer,
+                                 sizeof(input_buffer));
+                if (n > 0) {
+                        input = input_buffer;
+                        input_next = 1;
+                        input_end = n;
+                        return input[0];
+                }
+                if (n < 0 && errno == EINTR)
+                        continue;
+                return EOF;
+        }
+}
+
+static inline int next_char(void)
+{
+        if (input_next < input_end)
+                return input[input_next++];
+        return refill_input();
+}
+
+/* printf for the rare messages, into the output buffer */
+#define MESSAGE(...) \
+  do { \
+          reserve_output(LINE_MAX_BYTES);                               \
+          output_used += snprintf(output + output_used, LINE_MAX_BYTES, \
+                                  __VA_ARGS__);                         \
+  } while (false)
+
+static const char digit_pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233"
+        "34353637383940414243444546474849505152535455565758596061626364656667"
+        "6869707172737475767778798081828384858687888990919293949596979899";
+
+/*
+ * write ">>> %d\n" for word at dest, two digits at a time from the right
+ * returns the number of bytes written, at most 16
+ */
+static int format_line(char *dest, Um_word word)
+{
+        char digits[10];
+        char *d = digits + sizeof(digits);
+        Um_word magnitude = (int32_t) word < 0 ? -word : word;
+
+        while (magnitude >= 100) {
+                const char *pair = &digit_pairs[2 * (magnitude % 100)];
+                magnitude /= 100;
+                *--d = pair[1];
+                *--d = pair[0];
+        }
+        if (magnitude >= 10) {
+                const char *pair = &digit_pairs[2 * magnitude];
+                *--d = pair[1];
+                *--d = pair[0];
+        } else {
+                *--d = '0' + magnitude;
+        }
+
+        char *p = dest;
+        memcpy(p, ">>> ", 4);
+        p += 4;
+        if ((int32_t) word < 0)
+                *p++ = '-';
+        int n = digits + sizeof(digits) - d;
+        memcpy(p, d, n);
+        p += n;
+        *p++ = '\n';
+        return p - dest;
 }
 
 /*
  * return true iff sequence has at least n elements
  * when returning false, writes an error message about stack underflow
  */
-static bool has(Seq_T sequence, int n);
+static bool has(Stack values, int n);
 
 /*
  * implement binary operator.  Macro needed because OPERATOR is not a C value
@@ -56,7 +235,7 @@ static bool has(Seq_T sequence, int n);
   } while (false)
 
 
-static void run(Seq_T values)
+static void run(Stack values)
 {
         int c; /* character from standard input */
 waiting:
@@ -64,7 +243,7 @@ waiting:
          * if we are not entering a number, we are here,
          * awaiting instructions
          */
-        c = getchar();
+        c = next_char();
 
 waiting_with_character:
         switch (c) {
@@ -87,7 +266,7 @@ waiting_with_character:
                         Um_word y = pop(values);
                         Um_word x = pop(values);
                         if (y == 0) {
-                                printf("Division by zero\n");
+                                MESSAGE("Division by zero\n");
                                 push(values, x);
                                 push(values, y);
                         } else if ((int32_t) x < 0) {
@@ -129,29 +308,32 @@ waiting_with_character:
                 if (has(values, 1))
                         pop(values);
                 goto waiting;
-        case '\n': /* print the value stack */
-                for (int i = Seq_length(values); i > 0; i--)
-                        printf(">>> %d\n", get(values, i - 1));
+        case '\n': /* print the value stack, top first */
+                reserve_output(16 * (size_t) values->length);
+                for (int i = values->length; i > 0; i--)
+                        output_used += format_line(output + output_used,
+                                                   get(values, i - 1));
+                if (output_used >= OUTPUT_FLUSH)
+                        flush_output();
                 goto waiting;
-        case 'z': /* clear (zero out) the value stack by popping all elements */
-                while (Seq_length(values) > 0)
-                        Seq_remlo(values);
+        case 'z': /* clear (zero out) the value stack */
+                values->length = 0;
                 goto waiting;
         default:
                 if (c != ' ')
-                        printf("Unknown character '%c'\n", c);
+                        MESSAGE("Unknown character '%c'\n", c);
                 goto waiting;
         }
 entering:
         /* we are in the middle of entering a number */
-        c = getchar();
+        c = next_char();
         switch (c) {
                 /* if we see a digit, add it to number on top of the stack */
         case '0': case '1': case '2': case '3': case '4':
         case '5': case '6': case '7': case '8': case '9':
                 assert(has(values, 1));
-                Um_word w = pop(values);
-                push(values, 10 * w + c - '0');
+                Um_word *w = peek(values);
+                *w = 10 * *w + c - '0';
                 goto entering;
 
                 // if we see anything else, behave as if waiting
@@ -160,22 +342,221 @@ entering:
         }
 }
 
-int main() 
+/*
+ * Batch mode (calc40 -b): a 'z' at the start of a line leaves the
+ * calculator just as it starts, with an empty stack and no number being
+ * entered, so the input is split there, and at the start of each file,
+ * into sessions that can run on their own, in any order. Consecutive
+ * sessions are grouped into jobs of at least JOB_BYTES. Worker threads
+ * take jobs in order, each running them on its own stack into an output
+ * buffer of the job's own, and the main thread writes each job's output
+ * once it and every job before it are done.
+ */
+enum { JOB_BYTES = 256 * 1024 };
+
+typedef struct Job {
+        const unsigned char *text;
+        size_t length;
+        char *output;
+        size_t output_used;
+        bool done;
+} Job;
+
+static struct {
+        Job *jobs;
+        int length;
+        int capacity;
+        int next;               /* first job no worker has taken */
+        pthread_mutex_t lock;
+        pthread_cond_t done;
+} batch = { NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER,
+            PTHREAD_COND_INITIALIZER };
+
+static void add_job(const unsigned char *text, size_t length)
+{
+        if (batch.length == batch.capacity) {
+                batch.capacity = batch.capacity ? 2 * batch.capacity : 64;
+                batch.jobs = realloc(batch.jobs,
+                                     batch.capacity * sizeof(Job));
+                assert(batch.jobs != NULL);
+        }
+        batch.jobs[batch.length++] = (Job) { text, length, NULL, 0, false };
+}
+
+/* split one file's sessions into jobs, cutting only before a "\nz" */
+static void add_jobs(const unsigned char *text, size_t length)
+{
+        size_t start = 0;
+        while (length - start > JOB_BYTES) {
+                const unsigned char *p = text + start + JOB_BYTES - 1;
+                const unsigned char *end = text + length - 1;
+                while ((p = memchr(p, '\n', end - p)) != NULL && p[1] != 'z')
+                        p++;
+                if (p == NULL)
+                        break;
+                size_t cut = p + 1 - text;
+                add_job(text + start, cut - start);
+                start = cut;
+        }
+        add_job(text + start, length - start);
+}
+
+static void *worker(void *unused)
+{
+        (void) unused;
+        Stack values = Stack_new(1024);
+        in_memory = true;
+
+        for (;;) {
+                pthread_mutex_lock(&batch.lock);
+                int i = batch.next < batch.length ? batch.next++ : -1;
+                pthread_mutex_unlock(&batch.lock);
+                if (i < 0)
+                        break;
+
+                Job *job = &batch.jobs[i];
+                input = job->text;
+                input_next = 0;
+                input_end = job->length;
+                values->length = 0;
+                output = NULL;
+                output_used = output_capacity = 0;
+                run(values);
+
+                pthread_mutex_lock(&batch.lock);
+                job->output = output;
+                job->output_used = output_used;
+                job->done = true;
+                pthread_cond_broadcast(&batch.done);
+                pthread_mutex_unlock(&batch.lock);
+        }
+
+        Stack_free(&values);
+        return NULL;
+}
+
+static unsigned char *read_all(int fd, size_t *length)
+{
+        size_t capacity = INPUT_SIZE;
+        unsigned char *bytes = malloc(capacity);
+        assert(bytes != NULL);
+        *length = 0;
+
+        for (;;) {
+                if (*length == capacity) {
+                        capacity *= 2;
+                        bytes = realloc(bytes, capacity);
+                        assert(bytes != NULL);
+                }
+                ssize_t n = read(fd, bytes + *length, capacity - *length);
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n <= 0)
+                        return bytes;
+                *length += n;
+        }
+}
+
+/*
+ * run every file (standard input if there are none) as its own sessions
+ * on threads workers, writing the output in input order
+ * returns EXIT_FAILURE if a file cannot be read
+ */
+static int run_batch(char *files[], int num_files, int threads)
 {
-        Seq_T values = Seq_new(10);
+        int num_texts = num_files > 0 ? num_files : 1;
+        unsigned char **texts = malloc(num_texts * sizeof(*texts));
+        assert(texts != NULL);
+
+        for (int i = 0; i < num_texts; i++) {
+                int fd = STDIN_FILENO;
+                if (num_files > 0 && (fd = open(files[i], O_RDONLY)) < 0) {
+                        fprintf(stderr, "calc40: cannot open %s\n", files[i]);
+                        return EXIT_FAILURE;
+                }
+                size_t length;
+                texts[i] = read_all(fd, &length);
+                if (fd != STDIN_FILENO)
+                        close(fd);
+                add_jobs(texts[i], length);
+        }
+
+        if (threads > batch.length)
+                threads = batch.length;
+        pthread_t *workers = malloc(threads * sizeof(pthread_t));
+        assert(workers != NULL);
+        for (int i = 0; i < threads; i++) {
+                int rc = pthread_create(&workers[i], NULL, worker, NULL);
+                assert(rc == 0);
+        }
+
+        for (int i = 0; i < batch.length; i++) {
+                Job *job = &batch.jobs[i];
+                pthread_mutex_lock(&batch.lock);
+                while (!job->done)
+                        pthread_cond_wait(&batch.done, &batch.lock);
+                pthread_mutex_unlock(&batch.lock);
+                write_all(job->output, job->output_used);
+                free(job->output);
+        }
+
+        for (int i = 0; i < threads; i++)
+                pthread_join(workers[i], NULL);
+        free(workers);
+        for (int i = 0; i < num_texts; i++)
+                free(texts[i]);
+        free(texts);
+        free(batch.jobs);
+        return EXIT_SUCCESS;
+}
+
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-b [-j threads] [file ...]]\n", program);
+        exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+        bool batch_mode = false;
+        long threads = sysconf(_SC_NPROCESSORS_ONLN);
+        int c;
+
+        while ((c = getopt(argc, argv, "bj:")) != -1) {
+                switch (c) {
+                case 'b':
+                        batch_mode = true;
+                        break;
+                case 'j':
+                        threads = atol(optarg);
+                        break;
+                default:
+                        usage(argv[0]);
+                }
+        }
+        if (threads < 1)
+                threads = 1;
+        if (batch_mode)
+                return run_batch(argv + optind, argc - optind, threads);
+        if (optind != argc)
+                usage(argv[0]);
+
+        Stack values = Stack_new(1024);
         run(values);
-        Seq_free(&values);
+        flush_output();
+        free(output);
+        Stack_free(&values);
         return EXIT_SUCCESS;
 }
 
-static bool has(Seq_T sequence, int n)
+static bool has(Stack values, int n)
 {
-        if (Seq_length(sequence) >= n)
+        if (values->length >= n)
                 return true;
         else {
-                printf("Stack underflow---expected at least %d element%s\n",
-                       n,
-                       n == 1 ? "" : "s");
+                MESSAGE("Stack underflow---expected at least %d element%s\n",
+                        n,
+                        n == 1 ? "" : "s");
                 return false;
         }
 }
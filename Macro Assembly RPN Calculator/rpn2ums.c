@@ -0,0 +1,364 @@
+/* Name: rpn2ums.c
+ * Purpose: rpn2ums compiles a calc40 script into UM assembly that prints
+ * exactly what calc40 would print reading the script. The rpn2um script
+ * links the result with printd.ums into a UM program.
+ *
+ * A script reads nothing at run time, so every value it computes is a
+ * constant: the compiler runs the script itself, folding each operator
+ * into the value it produces, and swap, dup, pop and clear only move
+ * values around in the compiler. What remains for the UM is the output.
+ * Messages become output strings. The value stack is kept in a data
+ * segment; before each newline only the slots whose value changed since
+ * the last print are stored, and a loop calls print_number on each value,
+ * top first.
+ *
+ * Usage: rpn2ums [script] > script.ums
+ * By: Bradley Chao and Matthew Soto
+ * Date: 10/18/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+
+typedef uint32_t Um_word;
+
+/* the value stack as the compiler sees it */
+typedef struct Stack {
+        Um_word *words;
+        int length;
+        int capacity;
+} Stack;
+
+/* what the UM's copy of the stack holds, slot by slot */
+typedef struct Image {
+        Um_word *words;
+        bool *stored;   /* slot has been written at least once */
+        int capacity;
+        int high_water; /* slots the data segment needs */
+} Image;
+
+static void push(Stack *values, Um_word word)
+{
+        if (values->length == values->capacity) {
+                values->capacity = values->capacity ? 2 * values->capacity
+                                                    : 1024;
+                values->words = realloc(values->words,
+                                        values->capacity * sizeof(Um_word));
+                assert(values->words != NULL);
+        }
+        values->words[values->length++] = word;
+}
+
+static Um_word pop(Stack *values)
+{
+        return values->words[--values->length];
+}
+
+/************************************************************************
+ *                              Emission                                *
+ ************************************************************************/
+
+static bool literal(unsigned char c)
+{
+        return c == '\n' || (c >= ' ' && c <= '~' && c != '"' && c != '\\');
+}
+
+/* Name: emit_output
+*  Purpose: Emit UM assembly printing a message
+*  Parameters: Bytes and their length
+*  Returns: none
+*  Effects: Bytes a .ums string cannot hold literally are output by value
+*/
+static void emit_output(const char *text, size_t length)
+{
+        size_t i = 0;
+        while (i < length) {
+                if (!literal(text[i])) {
+                        printf("        output %u\n",
+                               (unsigned char) text[i++]);
+                        continue;
+                }
+                printf("        output \"");
+                for (; i < length && literal(text[i]); i++) {
+                        if (text[i] == '\n') {
+                                printf("\\n");
+                        }
+                        else {
+                                putchar(text[i]);
+                        }
+                }
+                printf("\"\n");
+        }
+}
+
+static void message(const char *format, ...)
+{
+        char text[128];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        emit_output(text, length);
+}
+
+/* Name: emit_print
+*  Purpose: Emit the printing of the whole stack, top first
+*  Parameters: Compile-time stack, UM's copy
+*  Returns: none
+*  Effects: Stores the slots whose value the UM does not have yet
+*/
+static void emit_print(const Stack *values, Image *image)
+{
+        if (values->length == 0) {
+                return;
+        }
+
+        if (values->length > image->capacity) {
+                int old = image->capacity;
+                image->capacity = 2 * values->length;
+                image->words = realloc(image->words,
+                                       image->capacity * sizeof(Um_word));
+                image->stored = realloc(image->stored,
+                                        image->capacity * sizeof(bool));
+                assert(image->words != NULL && image->stored != NULL);
+                memset(image->stored + old, 0,
+                       (image->capacity - old) * sizeof(bool));
+        }
+        if (values->length > image->high_water) {
+                image->high_water = values->length;
+        }
+
+        for (int i = 0; i < values->length; i++) {
+                Um_word w = values->words[i];
+                if (image->stored[i] && image->words[i] == w) {
+                        continue;
+                }
+                printf("        r4 := %u\n", w);
+                printf("        m[r0][rpn_values + %d] := r4\n", i);
+                image->words[i] = w;
+                image->stored[i] = true;
+        }
+
+        printf("        r3 := %d\n", values->length);
+        printf("        goto rpn_print_stack linking r1\n");
+}
+
+static void emit_prologue(void)
+{
+        printf("# Compiled by rpn2ums; link with printd.ums\n"
+               ".section init\n"
+               "        .temps r6, r7\n"
+               "        r0 := 0\n"
+               "        .zero r0\n"
+               "        r2 := rpn_call_stack\n"
+               "        goto main linking r1\n"
+               "        halt\n"
+               "\n"
+               ".section text\n"
+               "main:\n");
+}
+
+/* print_number from printd.ums on values r3 - 1 down to 0 */
+static void emit_epilogue(const Image *image)
+{
+        printf("        halt\n"
+               "\n"
+               "rpn_print_stack:\n"
+               "        push r1 on stack r2\n"
+               "rpn_print_next:\n"
+               "        r3 := r3 - 1\n"
+               "        r4 := m[r0][r3 + rpn_values]\n"
+               "        push r4 on stack r2\n"
+               "        goto print_number linking r1\n"
+               "        pop stack r2\n"
+               "        if (r3 != 0) goto rpn_print_next\n"
+               "        pop r5 off stack r2\n"
+               "        goto r5\n"
+               "\n"
+               ".section data\n"
+               "rpn_values:\n"
+               "        .space %d\n"
+               "        .space 64\n"
+               "rpn_call_stack:\n", image->high_water > 0 ? image->high_water
+                                                          : 1);
+}
+
+/************************************************************************
+ *                              Compiler                                *
+ ************************************************************************/
+
+static bool has(Stack *values, int n)
+{
+        if (values->length >= n) {
+                return true;
+        }
+        message("Stack underflow---expected at least %d element%s\n", n,
+                n == 1 ? "" : "s");
+        return false;
+}
+
+/* calc40's division, which truncates toward zero */
+static void divide(Stack *values)
+{
+        Um_word y = pop(values);
+        Um_word x = pop(values);
+
+        if (y == 0) {
+                message("Division by zero\n");
+                push(values, x);
+                push(values, y);
+        }
+        else if ((int32_t) x < 0) {
+                if ((int32_t) y < 0) {
+                        push(values, (0 - x) / (0 - y));
+                }
+                else {
+                        push(values, 0 - (0 - x) / y);
+                }
+        }
+        else if ((int32_t) y < 0) {
+                push(values, 0 - x / (0 - y));
+        }
+        else {
+                push(values, x / y);
+        }
+}
+
+/* Name: compile
+*  Purpose: Run a script at compile time, emitting its output
+*  Parameters: Script bytes and length
+*  Returns: none
+*  Effects: Writes UM assembly to standard output
+*/
+static void compile(const unsigned char *script, size_t length)
+{
+        Stack values = { NULL, 0, 0 };
+        Image image = { NULL, NULL, 0, 0 };
+        bool entering = false;
+
+        emit_prologue();
+
+        for (size_t i = 0; i < length; i++) {
+                int c = script[i];
+
+                if (c >= '0' && c <= '9') {
+                        if (entering) {
+                                Um_word *top = &values.words[values.length - 1];
+                                *top = 10 * *top + c - '0';
+                        }
+                        else {
+                                push(&values, c - '0');
+                        }
+                        entering = true;
+                        continue;
+                }
+                entering = false;
+
+                Um_word x, y;
+                switch (c) {
+                case '+': case '-': case '*': case '&': case '|':
+                        if (!has(&values, 2))
+                                break;
+                        y = pop(&values);
+                        x = pop(&values);
+                        push(&values, c == '+' ? x + y : c == '-' ? x - y :
+                                      c == '*' ? x * y : c == '&' ? x & y :
+                                      x | y);
+                        break;
+                case '~': case 'c':
+                        if (!has(&values, 1))
+                                break;
+                        x = pop(&values);
+                        push(&values, c == '~' ? ~x : 0 - x);
+                        break;
+                case '/':
+                        if (has(&values, 2))
+                                divide(&values);
+                        break;
+                case 's':
+                        if (!has(&values, 2))
+                                break;
+                        y = pop(&values);
+                        x = pop(&values);
+                        push(&values, y);
+                        push(&values, x);
+                        break;
+                case 'd':
+                        if (has(&values, 1))
+                                push(&values, values.words[values.length - 1]);
+                        break;
+                case 'p':
+                        if (has(&values, 1))
+                                pop(&values);
+                        break;
+                case '\n':
+                        emit_print(&values, &image);
+                        break;
+                case 'z':
+                        values.length = 0;
+                        break;
+                case ' ':
+                        break;
+                default:
+                        message("Unknown character '%c'\n", c);
+                        break;
+                }
+        }
+
+        emit_epilogue(&image);
+
+        free(values.words);
+        free(image.words);
+        free(image.stored);
+}
+
+static unsigned char *read_all(FILE *fp, size_t *length)
+{
+        size_t capacity = 1 << 16;
+        unsigned char *bytes = malloc(capacity);
+        assert(bytes != NULL);
+        *length = 0;
+
+        size_t n;
+        while ((n = fread(bytes + *length, 1, capacity - *length, fp)) > 0) {
+                *length += n;
+                if (*length == capacity) {
+                        capacity *= 2;
+                        bytes = realloc(bytes, capacity);
+                        assert(bytes != NULL);
+                }
+        }
+        return bytes;
+}
+
+int main(int argc, char *argv[])
+{
+        FILE *fp = stdin;
+        if (argc > 2) {
+                fprintf(stderr, "Usage: %s [script] > script.ums\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (argc == 2) {
+                fp = fopen(argv[1], "rb");
+                if (fp == NULL) {
+                        fprintf(stderr, "%s: cannot open %s\n", argv[0],
+                                argv[1]);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        size_t length;
+        unsigned char *script = read_all(fp, &length);
+        if (fp != stdin) {
+                fclose(fp);
+        }
+
+        compile(script, length);
+        free(script);
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+/* Name: rpngen.c
+ * Purpose: rpngen writes calc40 scripts for benchmarking. Each shape leans
+ * on one part of the calculator: deep stacks, long numbers, printing or
+ * division. Scripts are split into sessions of -l lines, each ended by a
+ * 'z' line, and the generator tracks the stack depth so that no session
+ * underflows or grows without bound. The same seed gives the same script.
+ *
+ * Usage: rpngen [-n bytes] [-l lines] [-d depth] [-r seed] shape > script
+ *      -n      about how many bytes to write (default 1000000)
+ *      -l      lines per session (default 100)
+ *      -d      values pushed by each line of the deep shape (default 500)
+ *      -r      seed (default 1)
+ * By: Bradley Chao and Matthew Soto
+ * Date: 10/18/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint64_t state;
+static int depth;       /* the calculator's stack depth at this point */
+static int deep_push = 500;
+static long written;    /* bytes of script so far */
+
+/* xorshift64*, so scripts do not depend on the C library's rand */
+static uint32_t random_word(void)
+{
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (state * 2685821657736338717ull) >> 32;
+}
+
+static uint32_t random_below(uint32_t n)
+{
+        return random_word() % n;
+}
+
+static void put(char c)
+{
+        putchar(c);
+        written++;
+}
+
+static void put_text(const char *text)
+{
+        fputs(text, stdout);
+        written += strlen(text);
+}
+
+/* Pushes a number with digits digits, the first of them nonzero */
+static void number(int digits)
+{
+        put('1' + random_below(9));
+        for (int i = 1; i < digits; i++) {
+                put('0' + random_below(10));
+        }
+        put(' ');
+        depth++;
+}
+
+/* Pops what the last line left, so that the line prints only its own */
+static void drop_all(void)
+{
+        for (; depth > 0; depth--) {
+                put_text("p ");
+        }
+}
+
+static char random_operator(void)
+{
+        static const char operators[] = "+-*&|";
+        return operators[random_below(sizeof(operators) - 1)];
+}
+
+/* Name: deep_line
+*  Purpose: Push -d values, fold them with -d - 1 operators
+*  Parameters: none
+*  Returns: none
+*  Effects: Leaves one value, printed by the newline
+*/
+static void deep_line(void)
+{
+        drop_all();
+        for (int i = 0; i < deep_push; i++) {
+                number(1 + random_below(4));
+        }
+        for (int i = 1; i < deep_push; i++) {
+                put(random_operator());
+                depth--;
+        }
+        put('\n');
+}
+
+/* a chain of nine- and ten-digit numbers, one digit at a time */
+static void long_line(void)
+{
+        drop_all();
+        number(9 + random_below(2));
+        int n = 4 + random_below(5);
+        for (int i = 0; i < n; i++) {
+                number(9 + random_below(2));
+                put(random_operator());
+                depth--;
+        }
+        put('\n');
+}
+
+/* Name: print_line
+*  Purpose: Keep 8 to 32 values on the stack and print them all
+*  Parameters: none
+*  Returns: none
+*  Effects: Mostly output: every newline prints the whole stack
+*/
+static void print_line(void)
+{
+        int n = 1 + random_below(4);
+        for (int i = 0; i < n; i++) {
+                if (depth < 8 || (depth < 32 && random_below(2) == 0)) {
+                        number(1 + random_below(10));
+                        continue;
+                }
+                switch (random_below(4)) {
+                case 0:
+                        put_text("d ");
+                        depth++;
+                        break;
+                case 1:
+                        put_text(random_below(2) ? "s " : "c ");
+                        break;
+                default:
+                        put(random_operator());
+                        put(' ');
+                        depth--;
+                        break;
+                }
+        }
+        put('\n');
+}
+
+/* Signed quotients of every sign, and now and then a zero divisor */
+static void divide_line(void)
+{
+        drop_all();
+        int n = 1 + random_below(4);
+        for (int i = 0; i < n; i++) {
+                number(1 + random_below(10));
+                if (random_below(2)) {
+                        put_text("c ");
+                }
+                if (random_below(16) == 0) {
+                        put_text("0 /");
+                        depth++;
+                        continue;
+                }
+                number(1 + random_below(5));
+                if (random_below(2)) {
+                        put_text("c ");
+                }
+                put('/');
+                depth--;
+        }
+        put('\n');
+}
+
+static void mixed_line(void);
+
+static struct shape {
+        const char *name;
+        const char *description;
+        void (*line)(void);
+} shapes[] = {
+        { "deep", "-d values per line folded to one", deep_line },
+        { "long", "nine- and ten-digit numbers", long_line },
+        { "print", "8-32 values printed on every line", print_line },
+        { "divide", "signed division, some by zero", divide_line },
+        { "mixed", "each line one of the above", mixed_line }
+};
+
+#define NSHAPES (sizeof(shapes) / sizeof(shapes[0]))
+
+static void mixed_line(void)
+{
+        /* any shape but this one, the last */
+        shapes[random_below(NSHAPES - 1)].line();
+}
+
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-n bytes] [-l lines] [-d depth] "
+                "[-r seed] shape\n", program);
+        for (size_t i = 0; i < NSHAPES; i++) {
+                fprintf(stderr, "        %-8s%s\n", shapes[i].name,
+                        shapes[i].description);
+        }
+        exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+        long bytes = 1000000;
+        long lines = 100;
+        unsigned long seed = 1;
+        int c;
+
+        while ((c = getopt(argc, argv, "n:l:d:r:")) != -1) {
+                switch (c) {
+                case 'n':
+                        bytes = atol(optarg);
+                        break;
+                case 'l':
+                        lines = atol(optarg);
+                        break;
+                case 'd':
+                        deep_push = atoi(optarg);
+                        break;
+                case 'r':
+                        seed = strtoul(optarg, NULL, 0);
+                        break;
+                default:
+                        usage(argv[0]);
+                }
+        }
+        if (optind != argc - 1 || bytes <= 0 || lines <= 0 || deep_push <= 0) {
+                usage(argv[0]);
+        }
+
+        struct shape *shape = NULL;
+        for (size_t i = 0; i < NSHAPES; i++) {
+                if (strcmp(argv[optind], shapes[i].name) == 0) {
+                        shape = &shapes[i];
+                }
+        }
+        if (shape == NULL) {
+                usage(argv[0]);
+        }
+
+        state = seed * 0x9E3779B97F4A7C15ull + 1;
+        while (written < bytes) {
+                for (long i = 0; i < lines; i++) {
+                        shape->line();
+                }
+                put_text("z\n");
+                depth = 0;
+        }
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,1691 @@
+/* Name: umasm.c
+ * Purpose: umasm assembles and links the UM macro assembly (.ums) used by
+ * the calculator into a UM program image. Every file is read in turn into
+ * named sections; the image is the init section, then text, then the
+ * other sections in the order they first appear. Labels are global across
+ * files.
+ *
+ * Usage: umasm [-O0] file.ums ... > program.um
+ *
+ * Macro instructions (arithmetic with immediates, comparisons, goto,
+ * push/pop, output of strings) expand into UM instructions that clobber
+ * the registers named by .temps, plus any named with "using". .zero names
+ * a register the program keeps at zero; without one, jumps and stack
+ * operations need a spare temporary to hold the zero.
+ *
+ * Unless -O0 is given, a peephole pass then works on each basic block of
+ * the expansion: it drops LOAD_VALUEs of a value the register already
+ * holds (a string's repeated characters, the -1 of consecutive pushes),
+ * drops LOAD_VALUEs overwritten before they are read, sends jumps to a
+ * jump straight to its target and removes jumps to the next instruction.
+ * By: Bradley Chao and Matthew Soto
+ * Date: 10/18/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <assert.h>
+
+typedef enum Opcode {
+        CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV, NAND, HALT, MAP, UNMAP, OUT,
+        IN, LOADP, LV
+} Opcode;
+
+typedef enum Item_kind { INSTRUCTION, WORD, SPACE, LABEL } Item_kind;
+
+/* What the peephole pass may assume of an instruction from a macro: a
+ * JUMP_TARGET LOAD_VALUE puts a code address in a scratch register only
+ * to jump there, and a LOCAL_JUMP is a LOAD_PROGRAM of segment 0 */
+enum { JUMP_TARGET = 1, LOCAL_JUMP = 2 };
+
+/* One instruction, data word, run of zero words or label in a section.
+ * The value of a LOAD_VALUE or data word is offset plus the address of
+ * symbol, when there is one. */
+typedef struct Item {
+        Item_kind kind;
+        Opcode op;
+        int a, b, c;
+        uint32_t offset;
+        int symbol;     /* Index in the symbol table, -1 for none */
+        unsigned flags;
+} Item;
+
+typedef struct Section {
+        char *name;
+        Item *items;
+        int length, capacity;
+} Section;
+
+typedef struct Symbol {
+        char *name;
+        int section;    /* -1 until defined */
+        uint32_t address;
+        const char *file;
+        int line;
+} Symbol;
+
+enum { MAX_SECTIONS = 32, MAX_LINE = 4096, NO_REG = -1 };
+
+static Section sections[MAX_SECTIONS];
+static int num_sections;
+
+static Symbol *symbols;
+static int num_symbols, symbols_capacity;
+static int *symbol_table;       /* Open addressing, -1 for empty */
+static int symbol_table_size;
+
+/* Assembler state for the file being read */
+static const char *file_name;
+static int line_number;
+static int current_section;
+static int temps[2], num_temps;
+static int zero_reg;
+static int generated_labels;
+
+static void fail(const char *format, ...)
+{
+        va_list args;
+        va_start(args, format);
+        fprintf(stderr, "%s:%d: ", file_name, line_number);
+        vfprintf(stderr, format, args);
+        fprintf(stderr, "\n");
+        va_end(args);
+        exit(EXIT_FAILURE);
+}
+
+/************************************************************************
+ *                          Sections and symbols                        *
+ ************************************************************************/
+
+static int find_section(const char *name)
+{
+        for (int i = 0; i < num_sections; i++) {
+                if (strcmp(sections[i].name, name) == 0) {
+                        return i;
+                }
+        }
+        if (num_sections == MAX_SECTIONS) {
+                fail("too many sections");
+        }
+        sections[num_sections].name = strdup(name);
+        assert(sections[num_sections].name != NULL);
+        return num_sections++;
+}
+
+static uint32_t hash(const char *name)
+{
+        uint32_t h = 2166136261u;
+        for (; *name != '\0'; name++) {
+                h = (h ^ (unsigned char) *name) * 16777619u;
+        }
+        return h;
+}
+
+static void grow_symbol_table(void)
+{
+        free(symbol_table);
+        symbol_table_size = symbol_table_size ? 2 * symbol_table_size : 1024;
+        symbol_table = malloc(symbol_table_size * sizeof(int));
+        assert(symbol_table != NULL);
+        memset(symbol_table, -1, symbol_table_size * sizeof(int));
+
+        for (int i = 0; i < num_symbols; i++) {
+                uint32_t slot = hash(symbols[i].name) &
+                                (symbol_table_size - 1);
+                while (symbol_table[slot] != -1) {
+                        slot = (slot + 1) & (symbol_table_size - 1);
+                }
+                symbol_table[slot] = i;
+        }
+}
+
+/* Name: lookup
+*  Purpose: Find a symbol, entering it undefined if it is new
+*  Parameters: Name
+*  Returns: Index of the symbol
+*  Effects: Checked runtime error if allocation fails
+*/
+static int lookup(const char *name)
+{
+        if (2 * (num_symbols + 1) > symbol_table_size) {
+                grow_symbol_table();
+        }
+
+        uint32_t slot = hash(name) & (symbol_table_size - 1);
+        while (symbol_table[slot] != -1) {
+                if (strcmp(symbols[symbol_table[slot]].name, name) == 0) {
+                        return symbol_table[slot];
+                }
+                slot = (slot + 1) & (symbol_table_size - 1);
+        }
+
+        if (num_symbols == symbols_capacity) {
+                symbols_capacity = symbols_capacity ? 2 * symbols_capacity
+                                                    : 256;
+                symbols = realloc(symbols, symbols_capacity * sizeof(Symbol));
+                assert(symbols != NULL);
+        }
+        Symbol *symbol = &symbols[num_symbols];
+        symbol->name = strdup(name);
+        assert(symbol->name != NULL);
+        symbol->section = -1;
+        symbol->file = file_name;
+        symbol->line = line_number;
+        symbol_table[slot] = num_symbols;
+        return num_symbols++;
+}
+
+/* A label no source can name, for the inside of a macro */
+static int new_label(void)
+{
+        char name[32];
+        snprintf(name, sizeof(name), "$%d", generated_labels++);
+        return lookup(name);
+}
+
+static Item *append(Item_kind kind)
+{
+        Section *s = &sections[current_section];
+        if (s->length == s->capacity) {
+                s->capacity = s->capacity ? 2 * s->capacity : 256;
+                s->items = realloc(s->items, s->capacity * sizeof(Item));
+                assert(s->items != NULL);
+        }
+        Item *item = &s->items[s->length++];
+        memset(item, 0, sizeof(*item));
+        item->kind = kind;
+        item->symbol = -1;
+        return item;
+}
+
+static void define_label(int symbol)
+{
+        if (symbols[symbol].section != -1) {
+                fail("label %s is already defined at %s:%d",
+                     symbols[symbol].name, symbols[symbol].file,
+                     symbols[symbol].line);
+        }
+        symbols[symbol].section = current_section;
+        symbols[symbol].file = file_name;
+        symbols[symbol].line = line_number;
+        append(LABEL)->symbol = symbol;
+}
+
+static void emit(Opcode op, int a, int b, int c)
+{
+        Item *item = append(INSTRUCTION);
+        item->op = op;
+        item->a = a;
+        item->b = b;
+        item->c = c;
+}
+
+static Item *emit_lv(int a, uint32_t value, int symbol)
+{
+        Item *item = append(INSTRUCTION);
+        item->op = LV;
+        item->a = a;
+        item->offset = value;
+        item->symbol = symbol;
+        return item;
+}
+
+/************************************************************************
+ *                               Lexer                                  *
+ ************************************************************************/
+
+typedef enum Token_kind { T_END, T_IDENT, T_NUMBER, T_STRING, T_PUNCT }
+        Token_kind;
+
+typedef struct Token {
+        Token_kind kind;
+        char text[MAX_LINE];    /* Identifier, string or punctuation */
+        uint32_t number;
+} Token;
+
+static const char *cursor;
+static Token token;
+
+static int escape(void)
+{
+        char c = *cursor++;
+        switch (c) {
+                case 'n': return '\n';
+                case 't': return '\t';
+                case 'r': return '\r';
+                case '0': return '\0';
+                case '\\': return '\\';
+                case '\'': return '\'';
+                case '"': return '"';
+                default: fail("unknown escape \\%c", c);
+        }
+        return 0;
+}
+
+static void next(void)
+{
+        while (isspace((unsigned char) *cursor)) {
+                cursor++;
+        }
+
+        const char *start = cursor;
+        char c = *cursor;
+        if (c == '\0' || c == '#' || (c == '/' && cursor[1] == '/')) {
+                token.kind = T_END;
+        }
+        else if (isalpha((unsigned char) c) || c == '_' || c == '.' ||
+                 c == '$') {
+                while (isalnum((unsigned char) *cursor) || *cursor == '_' ||
+                       *cursor == '.' || *cursor == '$') {
+                        cursor++;
+                }
+                token.kind = T_IDENT;
+                memcpy(token.text, start, cursor - start);
+                token.text[cursor - start] = '\0';
+        }
+        else if (isdigit((unsigned char) c)) {
+                char *end;
+                unsigned long long value = strtoull(cursor, &end, 0);
+                if (value > UINT32_MAX) {
+                        fail("%.*s does not fit in a word",
+                             (int) (end - cursor), cursor);
+                }
+                cursor = end;
+                token.kind = T_NUMBER;
+                token.number = value;
+        }
+        else if (c == '\'') {
+                cursor++;
+                int value = *cursor == '\\' ? (cursor++, escape())
+                                            : *cursor++;
+                if (*cursor++ != '\'') {
+                        fail("bad character constant");
+                }
+                token.kind = T_NUMBER;
+                token.number = (unsigned char) value;
+        }
+        else if (c == '"') {
+                size_t n = 0;
+                cursor++;
+                while (*cursor != '"') {
+                        if (*cursor == '\0') {
+                                fail("unterminated string");
+                        }
+                        token.text[n++] = *cursor == '\\' ?
+                                          (cursor++, escape()) : *cursor++;
+                }
+                cursor++;
+                token.kind = T_STRING;
+                token.number = n;
+        }
+        else {
+                static const char *two[] = { ":=", "==", "!=", "<=", ">=" };
+                token.kind = T_PUNCT;
+                for (size_t i = 0; i < sizeof(two) / sizeof(two[0]); i++) {
+                        if (strncmp(cursor, two[i], 2) == 0) {
+                                memcpy(token.text, two[i], 3);
+                                cursor += 2;
+                                return;
+                        }
+                }
+                token.text[0] = c;
+                token.text[1] = '\0';
+                cursor++;
+        }
+}
+
+static bool is(const char *text)
+{
+        return (token.kind == T_PUNCT || token.kind == T_IDENT) &&
+               strcmp(token.text, text) == 0;
+}
+
+static bool accept(const char *text)
+{
+        if (is(text)) {
+                next();
+                return true;
+        }
+        return false;
+}
+
+static void expect(const char *text)
+{
+        if (!accept(text)) {
+                fail("expected %s", text);
+        }
+}
+
+static int register_number(const char *text)
+{
+        if (text[0] == 'r' && text[1] >= '0' && text[1] <= '7' &&
+            text[2] == '\0') {
+                return text[1] - '0';
+        }
+        return NO_REG;
+}
+
+static bool at_register(void)
+{
+        return token.kind == T_IDENT && register_number(token.text) != NO_REG;
+}
+
+static int parse_register(void)
+{
+        if (!at_register()) {
+                fail("expected a register");
+        }
+        int r = register_number(token.text);
+        next();
+        return r;
+}
+
+/* A register or an immediate value, possibly label-relative */
+typedef struct Operand {
+        int reg;        /* NO_REG for an immediate */
+        uint32_t value;
+        int symbol;
+} Operand;
+
+static bool at_immediate(void)
+{
+        return token.kind == T_NUMBER ||
+               (token.kind == T_IDENT && !at_register()) ||
+               (is("-") && (isdigit((unsigned char) *cursor) ||
+                            *cursor == '\''));
+}
+
+static Operand parse_immediate(void)
+{
+        Operand o = { NO_REG, 0, -1 };
+        bool negative = accept("-");
+
+        if (token.kind == T_NUMBER) {
+                o.value = negative ? -token.number : token.number;
+        }
+        else if (token.kind == T_IDENT && !negative) {
+                o.symbol = lookup(token.text);
+        }
+        else {
+                fail("expected a value");
+        }
+        next();
+
+        /* label + k, k - 1, ... fold into one value */
+        while ((is("+") || is("-")) &&
+               (isdigit((unsigned char) *cursor) || *cursor == '\'' ||
+                isspace((unsigned char) *cursor))) {
+                const char *save = cursor;
+                Token saved = token;
+                bool minus = is("-");
+                next();
+                if (token.kind != T_NUMBER) {
+                        cursor = save;
+                        token = saved;
+                        break;
+                }
+                o.value += minus ? -token.number : token.number;
+                next();
+        }
+        return o;
+}
+
+static Operand parse_operand(void)
+{
+        if (at_register()) {
+                Operand o = { parse_register(), 0, -1 };
+                return o;
+        }
+        return parse_immediate();
+}
+
+/************************************************************************
+ *                          Macro expansion                             *
+ ************************************************************************/
+
+/* Registers a statement may clobber: the temps and any "using" */
+typedef struct Scratch {
+        int regs[8];
+        int count;
+        unsigned taken;
+} Scratch;
+
+static Scratch scratch;
+
+static int scratch_reg(unsigned avoid)
+{
+        for (int i = 0; i < scratch.count; i++) {
+                int r = scratch.regs[i];
+                if (!(scratch.taken & (1u << r)) && !(avoid & (1u << r))) {
+                        scratch.taken |= 1u << r;
+                        return r;
+                }
+        }
+        fail("not enough temporary registers (use .temps or using)");
+        return NO_REG;
+}
+
+static void release(int r)
+{
+        scratch.taken &= ~(1u << r);
+}
+
+static unsigned reg_bit(int r)
+{
+        return r == NO_REG ? 0 : 1u << r;
+}
+
+/* Registers in mask other than scratch ones, which may be reused once
+   an operand in them has been read */
+static unsigned not_scratch(unsigned mask)
+{
+        for (int i = 0; i < scratch.count; i++) {
+                mask &= ~(1u << scratch.regs[i]);
+        }
+        return mask;
+}
+
+static unsigned operand_bits(Operand o)
+{
+        return reg_bit(o.reg);
+}
+
+/* Name: load_constant
+*  Purpose: Put an immediate value in register r
+*  Parameters: Register, value, registers that must not be clobbered
+*  Returns: none
+*  Effects: Values needing more than 25 bits use one more scratch register
+*           unless their complement fits
+*/
+static void load_constant(int r, Operand o, unsigned avoid)
+{
+        uint32_t v = o.value;
+
+        if (o.symbol != -1 || v < (1u << 25)) {
+                emit_lv(r, v, o.symbol);
+        }
+        else if (~v < (1u << 25)) {
+                emit_lv(r, ~v, -1);
+                emit(NAND, r, r, r);
+        }
+        else {
+                int h = scratch_reg(avoid | reg_bit(r));
+                emit_lv(r, v >> 16, -1);
+                emit_lv(h, 1u << 16, -1);
+                emit(MUL, r, r, h);
+                if ((v & 0xffff) != 0) {
+                        emit_lv(h, v & 0xffff, -1);
+                        emit(ADD, r, r, h);
+                }
+                release(h);
+        }
+}
+
+static Operand constant(uint32_t v)
+{
+        Operand o = { NO_REG, v, -1 };
+        return o;
+}
+
+/* The register holding o, loading an immediate into a scratch register */
+static int in_register(Operand o, unsigned avoid)
+{
+        if (o.reg != NO_REG) {
+                return o.reg;
+        }
+        if (o.symbol == -1 && o.value == 0 && zero_reg != NO_REG) {
+                return zero_reg;
+        }
+        int r = scratch_reg(avoid);
+        load_constant(r, o, avoid | reg_bit(r));
+        return r;
+}
+
+static void move(int a, int b)
+{
+        if (a == b) {
+                return;
+        }
+        if (zero_reg != NO_REG) {
+                emit(ADD, a, b, zero_reg);
+        }
+        else {
+                int t = scratch_reg(reg_bit(a) | reg_bit(b));
+                emit_lv(t, 1, -1);
+                emit(CMOV, a, b, t);
+                release(t);
+        }
+}
+
+/* The register holding zero, for segment 0 */
+static int zero_register(unsigned avoid)
+{
+        if (zero_reg != NO_REG) {
+                return zero_reg;
+        }
+        int t = scratch_reg(avoid);
+        emit_lv(t, 0, -1);
+        return t;
+}
+
+static void jump_register(int target)
+{
+        int z = zero_register(reg_bit(target));
+        emit(LOADP, 0, z, target);
+        sections[current_section].items[sections[current_section].length - 1]
+                .flags = LOCAL_JUMP;
+}
+
+static void jump(int symbol, unsigned avoid)
+{
+        int t = scratch_reg(avoid);
+        emit_lv(t, 0, symbol)->flags = JUMP_TARGET;
+        jump_register(t);
+        release(t);
+}
+
+static bool foldable(Operand x, Operand y)
+{
+        return x.reg == NO_REG && y.reg == NO_REG && x.symbol == -1 &&
+               y.symbol == -1;
+}
+
+static uint32_t fold(const char *op, uint32_t x, uint32_t y)
+{
+        if (strcmp(op, "+") == 0) return x + y;
+        if (strcmp(op, "-") == 0) return x - y;
+        if (strcmp(op, "*") == 0) return x * y;
+        if (strcmp(op, "&") == 0) return x & y;
+        if (strcmp(op, "|") == 0) return x | y;
+        if (strcmp(op, "xor") == 0) return x ^ y;
+        if (strcmp(op, "nand") == 0) return ~(x & y);
+        if (y == 0) {
+                fail("division by zero in a constant");
+        }
+        if (strcmp(op, "/") == 0) return x / y;
+        return x % y;
+}
+
+/* Name: binary
+*  Purpose: Expand a := x op y
+*  Parameters: Destination, operator, operands
+*  Returns: none
+*  Effects: Clobbers scratch registers, never x or y before they are read
+*/
+static void binary(int a, const char *op, Operand x, Operand y)
+{
+        if (foldable(x, y)) {
+                load_constant(a, constant(fold(op, x.value, y.value)), 0);
+                return;
+        }
+
+        unsigned live = operand_bits(x) | operand_bits(y) | reg_bit(a);
+
+        if (strcmp(op, "-") == 0 && y.reg == NO_REG && y.symbol == -1) {
+                y.value = -y.value;
+                op = "+";
+        }
+
+        int rx = in_register(x, live);
+        live |= reg_bit(rx);
+        int ry = in_register(y, live);
+        live |= reg_bit(ry);
+
+        if (strcmp(op, "+") == 0) {
+                emit(ADD, a, rx, ry);
+        }
+        else if (strcmp(op, "*") == 0) {
+                emit(MUL, a, rx, ry);
+        }
+        else if (strcmp(op, "/") == 0) {
+                emit(DIV, a, rx, ry);
+        }
+        else if (strcmp(op, "nand") == 0) {
+                emit(NAND, a, rx, ry);
+        }
+        else if (strcmp(op, "&") == 0) {
+                emit(NAND, a, rx, ry);
+                emit(NAND, a, a, a);
+        }
+        else if (strcmp(op, "|") == 0) {
+                int t = scratch_reg(live);
+                emit(NAND, t, rx, rx);
+                emit(NAND, a, ry, ry);
+                emit(NAND, a, t, a);
+                release(t);
+        }
+        else if (strcmp(op, "xor") == 0) {
+                /* a can hold the middle term unless it is x or y */
+                bool in_place = a != rx && a != ry;
+                int t = scratch_reg(live);
+                int u = in_place ? a : scratch_reg(live | reg_bit(t));
+                emit(NAND, t, rx, ry);
+                emit(NAND, u, rx, t);
+                emit(NAND, t, ry, t);
+                emit(NAND, a, u, t);
+                release(t);
+                if (!in_place) {
+                        release(u);
+                }
+        }
+        else if (strcmp(op, "-") == 0 || strcmp(op, "mod") == 0) {
+                /* a := x + ~s + 1, s being y or (x / y) * y; a itself
+                   holds s unless x or y has to survive in it */
+                bool mod = strcmp(op, "mod") == 0;
+                bool in_place = a != rx && (!mod || a != ry);
+                int t = in_place ? a : scratch_reg(live);
+                int u = scratch_reg(live | reg_bit(t));
+                if (mod) {
+                        emit(DIV, t, rx, ry);
+                        emit(MUL, t, t, ry);
+                        emit(NAND, t, t, t);
+                }
+                else {
+                        emit(NAND, t, ry, ry);
+                }
+                emit_lv(u, 1, -1);
+                emit(ADD, t, t, u);
+                emit(ADD, a, rx, t);
+                if (!in_place) {
+                        release(t);
+                }
+                release(u);
+        }
+        else {
+                fail("unknown operator %s", op);
+        }
+
+        if (x.reg == NO_REG && rx != zero_reg) {
+                release(rx);
+        }
+        if (y.reg == NO_REG && ry != zero_reg) {
+                release(ry);
+        }
+}
+
+/* Name: branch_on
+*  Purpose: Jump to symbol if register d is nonzero (when == true) or
+*           zero (when == false), and fall through otherwise
+*  Parameters: Condition register, sense, target symbol, live registers
+*  Returns: none
+*  Effects: Uses two scratch registers
+*/
+static void branch_on(int d, bool when, int symbol, unsigned live)
+{
+        int after = new_label();
+        live |= reg_bit(d);
+        int z = scratch_reg(live);
+        int t = scratch_reg(live | reg_bit(z));
+
+        emit_lv(z, 0, when ? after : symbol)->flags = JUMP_TARGET;
+        emit_lv(t, 0, when ? symbol : after)->flags = JUMP_TARGET;
+        emit(CMOV, z, t, d);
+        release(t);
+        jump_register(z);
+        release(z);
+        define_label(after);
+}
+
+/* Name: branch_less
+*  Purpose: Jump to symbol if (x < y) == when, unsigned, or signed with the
+*           sign bits flipped by adding 2^31
+*  Parameters: Operands, signedness, sense, target symbol
+*  Returns: none
+*  Effects: Uses three scratch registers. x < y exactly when y != 0 and
+*           x / y == 0.
+*/
+static void branch_less(Operand x, Operand y, bool is_signed, bool when,
+                        int symbol)
+{
+        uint32_t bias = is_signed ? 1u << 31 : 0;
+        unsigned live = operand_bits(x) | operand_bits(y);
+
+        if (foldable(x, y)) {
+                if ((x.value + bias < y.value + bias) == when) {
+                        jump(symbol, live);
+                }
+                return;
+        }
+
+        int after = new_label();
+        int ry = y.reg;
+
+        if (y.reg == NO_REG && y.symbol == -1) {
+                if (y.value + bias == 0) {
+                        /* nothing is below zero */
+                        if (!when) {
+                                jump(symbol, live);
+                        }
+                        return;
+                }
+                ry = scratch_reg(live);
+                load_constant(ry, constant(y.value + bias), live | reg_bit(ry));
+        }
+        else if (y.reg == NO_REG || is_signed) {
+                ry = scratch_reg(live);
+                load_constant(ry, is_signed ? constant(bias) : y,
+                              live | reg_bit(ry));
+                if (is_signed) {
+                        emit(ADD, ry, y.reg, ry);
+                }
+        }
+        live |= reg_bit(ry);
+
+        /* y == 0: x < y is false */
+        branch_on(ry, false, when ? after : symbol, live);
+
+        int q = scratch_reg(live);
+        if (x.reg == NO_REG && x.symbol == -1) {
+                load_constant(q, constant(x.value + bias), live | reg_bit(q));
+                emit(DIV, q, q, ry);
+        }
+        else if (x.reg == NO_REG || is_signed) {
+                load_constant(q, is_signed ? constant(bias) : x,
+                              live | reg_bit(q));
+                if (is_signed) {
+                        emit(ADD, q, x.reg, q);
+                }
+                emit(DIV, q, q, ry);
+        }
+        else {
+                emit(DIV, q, x.reg, ry);
+        }
+        if (ry != y.reg) {
+                release(ry);
+        }
+
+        branch_on(q, !when, symbol, operand_bits(x) | operand_bits(y));
+        release(q);
+        define_label(after);
+}
+
+/* if (x relop y) goto label */
+static void conditional_goto(Operand x, const char *relop, bool is_signed,
+                             Operand y, int symbol)
+{
+        if (strcmp(relop, "==") == 0 || strcmp(relop, "!=") == 0) {
+                bool equal = strcmp(relop, "==") == 0;
+
+                if (foldable(x, y)) {
+                        if ((x.value == y.value) == equal) {
+                                jump(symbol, 0);
+                        }
+                        return;
+                }
+                if (x.reg == NO_REG) {
+                        Operand swap = x;
+                        x = y;
+                        y = swap;
+                }
+                if (y.reg == NO_REG && y.symbol == -1 && y.value == 0) {
+                        branch_on(x.reg, !equal, symbol, 0);
+                        return;
+                }
+
+                unsigned live = operand_bits(x) | operand_bits(y);
+                int d = scratch_reg(live);
+                binary(d, "-", x, y);
+                branch_on(d, !equal, symbol, not_scratch(live));
+                release(d);
+        }
+        else if (strcmp(relop, "<") == 0) {
+                branch_less(x, y, is_signed, true, symbol);
+        }
+        else if (strcmp(relop, ">") == 0) {
+                branch_less(y, x, is_signed, true, symbol);
+        }
+        else if (strcmp(relop, "<=") == 0) {
+                branch_less(y, x, is_signed, false, symbol);
+        }
+        else if (strcmp(relop, ">=") == 0) {
+                branch_less(x, y, is_signed, false, symbol);
+        }
+        else {
+                fail("unknown comparison %s", relop);
+        }
+}
+
+/************************************************************************
+ *                               Parser                                 *
+ ************************************************************************/
+
+static void parse_using(void)
+{
+        if (accept("using")) {
+                do {
+                        scratch.regs[scratch.count++] = parse_register();
+                } while (accept(","));
+        }
+}
+
+/* m[x][y] or m[x][y + k], leaving the segment and offset operands */
+static void parse_address(Operand *segment, Operand *index, Operand *offset)
+{
+        expect("m");
+        expect("[");
+        *segment = parse_operand();
+        expect("]");
+        expect("[");
+        *index = parse_operand();
+        *offset = constant(0);
+        if (index->reg != NO_REG && (is("+") || is("-"))) {
+                bool minus = is("-");
+                next();
+                *offset = parse_immediate();
+                if (minus) {
+                        offset->value = -offset->value;
+                }
+        }
+        expect("]");
+}
+
+/* The register holding segment index + offset */
+static int address_register(Operand index, Operand offset, unsigned live)
+{
+        if (offset.symbol == -1 && offset.value == 0) {
+                return in_register(index, live);
+        }
+        int t = scratch_reg(live);
+        binary(t, "+", index, offset);
+        return t;
+}
+
+static void parse_assignment(int a)
+{
+        expect(":=");
+
+        if (accept("input")) {
+                expect("(");
+                expect(")");
+                parse_using();
+                emit(IN, 0, 0, a);
+                return;
+        }
+        if (accept("map")) {
+                expect("segment");
+                expect("(");
+                Operand words = parse_operand();
+                expect("words");
+                expect(")");
+                parse_using();
+                emit(MAP, 0, a, in_register(words, reg_bit(a)));
+                return;
+        }
+        if (is("m")) {
+                Operand segment, index, offset;
+                parse_address(&segment, &index, &offset);
+                parse_using();
+                unsigned live = operand_bits(segment) | operand_bits(index);
+                int rb = in_register(segment, live);
+                int rc = address_register(index, offset, live | reg_bit(rb));
+                emit(SLOAD, a, rb, rc);
+                return;
+        }
+        if (accept("~")) {
+                Operand x = parse_operand();
+                parse_using();
+                binary(a, "nand", x, x);
+                return;
+        }
+        if (is("-") && !at_immediate()) {
+                next();
+                Operand x = parse_operand();
+                parse_using();
+                binary(a, "-", constant(0), x);
+                return;
+        }
+
+        Operand x = parse_operand();
+        const char *ops[] = { "+", "-", "*", "/", "&", "|", "nand", "xor",
+                              "mod" };
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+                if (accept(ops[i])) {
+                        Operand y = parse_operand();
+                        parse_using();
+                        binary(a, ops[i], x, y);
+                        return;
+                }
+        }
+        parse_using();
+        if (x.reg != NO_REG) {
+                move(a, x.reg);
+        }
+        else {
+                load_constant(a, x, reg_bit(a));
+        }
+}
+
+static void parse_goto(void)
+{
+        if (at_register()) {
+                int target = parse_register();
+                if (accept("in")) {
+                        expect("program");
+                        expect("m");
+                        expect("[");
+                        int segment = parse_register();
+                        expect("]");
+                        parse_using();
+                        emit(LOADP, 0, segment, target);
+                }
+                else {
+                        parse_using();
+                        jump_register(target);
+                }
+                return;
+        }
+
+        if (token.kind != T_IDENT) {
+                fail("expected a label");
+        }
+        int symbol = lookup(token.text);
+        next();
+
+        if (accept("linking")) {
+                int link = parse_register();
+                parse_using();
+                int back = new_label();
+                emit_lv(link, 0, back);
+                jump(symbol, reg_bit(link));
+                define_label(back);
+        }
+        else {
+                parse_using();
+                jump(symbol, 0);
+        }
+}
+
+static void parse_if(void)
+{
+        expect("(");
+        Operand x = parse_operand();
+
+        if (accept(")")) {
+                /* if (rC) rA := rB */
+                int a = parse_register();
+                expect(":=");
+                int b = parse_register();
+                emit(CMOV, a, b, x.reg);
+                return;
+        }
+
+        if (token.kind != T_PUNCT) {
+                fail("expected a comparison");
+        }
+        char relop[3];
+        strcpy(relop, token.text);
+        next();
+        if (strcmp(relop, "<") != 0 && strcmp(relop, ">") != 0 &&
+            strcmp(relop, "<=") != 0 && strcmp(relop, ">=") != 0 &&
+            strcmp(relop, "==") != 0 && strcmp(relop, "!=") != 0) {
+                fail("unknown comparison %s", relop);
+        }
+        bool is_signed = false;
+        if (token.kind == T_IDENT && strcmp(token.text, "s") == 0) {
+                is_signed = true;
+                next();
+        }
+        Operand y = parse_operand();
+        expect(")");
+
+        if (at_register()) {
+                /* if (rC != 0) rA := rB */
+                if (strcmp(relop, "!=") != 0 || y.reg != NO_REG ||
+                    y.value != 0 || x.reg == NO_REG) {
+                        fail("a conditional move tests (rC != 0)");
+                }
+                int a = parse_register();
+                expect(":=");
+                int b = parse_register();
+                emit(CMOV, a, b, x.reg);
+                return;
+        }
+
+        expect("goto");
+        if (token.kind != T_IDENT) {
+                fail("expected a label");
+        }
+        int symbol = lookup(token.text);
+        next();
+        parse_using();
+        conditional_goto(x, relop, is_signed, y, symbol);
+}
+
+static void parse_output(void)
+{
+        if (token.kind == T_STRING) {
+                int length = token.number;
+                char text[MAX_LINE];
+                memcpy(text, token.text, length);
+                next();
+                parse_using();
+                int t = scratch_reg(0);
+                for (int i = 0; i < length; i++) {
+                        emit_lv(t, (unsigned char) text[i], -1);
+                        emit(OUT, 0, 0, t);
+                }
+                release(t);
+                return;
+        }
+
+        Operand x = parse_operand();
+        parse_using();
+        emit(OUT, 0, 0, in_register(x, 0));
+}
+
+static void parse_directive(void)
+{
+        if (accept(".section")) {
+                if (token.kind != T_IDENT) {
+                        fail("expected a section name");
+                }
+                current_section = find_section(token.text);
+                next();
+        }
+        else if (accept(".temps")) {
+                num_temps = 0;
+                if (at_register()) {
+                        do {
+                                if (num_temps == 2) {
+                                        fail("at most two temps");
+                                }
+                                temps[num_temps++] = parse_register();
+                        } while (accept(","));
+                }
+        }
+        else if (accept(".zero")) {
+                zero_reg = accept("off") ? NO_REG : parse_register();
+        }
+        else if (accept(".space")) {
+                if (token.kind != T_NUMBER) {
+                        fail("expected a number of words");
+                }
+                append(SPACE)->offset = token.number;
+                next();
+        }
+        else if (accept(".data")) {
+                Operand o = parse_immediate();
+                Item *item = append(WORD);
+                item->offset = o.value;
+                item->symbol = o.symbol;
+        }
+        else {
+                fail("unknown directive %s", token.text);
+        }
+}
+
+static void parse_statement(void)
+{
+        scratch.count = 0;
+        scratch.taken = 0;
+        for (int i = 0; i < num_temps; i++) {
+                scratch.regs[scratch.count++] = temps[i];
+        }
+
+        if (token.kind == T_IDENT && token.text[0] == '.') {
+                parse_directive();
+        }
+        else if (at_register()) {
+                parse_assignment(parse_register());
+        }
+        else if (is("m")) {
+                Operand segment, index, offset;
+                parse_address(&segment, &index, &offset);
+                expect(":=");
+                Operand value = parse_operand();
+                parse_using();
+                unsigned live = operand_bits(segment) | operand_bits(index) |
+                                operand_bits(value);
+                int ra = in_register(segment, live);
+                live |= reg_bit(ra);
+                int rb = address_register(index, offset, live);
+                live |= reg_bit(rb);
+                emit(SSTORE, ra, rb, in_register(value, live));
+        }
+        else if (accept("if")) {
+                parse_if();
+        }
+        else if (accept("goto")) {
+                parse_goto();
+        }
+        else if (accept("halt")) {
+                emit(HALT, 0, 0, 0);
+        }
+        else if (accept("output")) {
+                parse_output();
+        }
+        else if (accept("unmap")) {
+                Operand segment;
+                if (accept("m")) {
+                        expect("[");
+                        segment = parse_operand();
+                        expect("]");
+                }
+                else {
+                        segment = parse_operand();
+                }
+                parse_using();
+                emit(UNMAP, 0, 0, in_register(segment, 0));
+        }
+        else if (accept("push")) {
+                /* the stack grows down: m[0][--sp] := x */
+                int x = parse_register();
+                expect("on");
+                expect("stack");
+                int sp = parse_register();
+                parse_using();
+                binary(sp, "+", (Operand) { sp, 0, -1 }, constant(-1));
+                int z = zero_register(reg_bit(x) | reg_bit(sp));
+                emit(SSTORE, z, sp, x);
+        }
+        else if (accept("pop")) {
+                int x = NO_REG;
+                if (!accept("stack")) {
+                        x = parse_register();
+                        expect("off");
+                        expect("stack");
+                }
+                int sp = parse_register();
+                parse_using();
+                if (x != NO_REG) {
+                        int z = zero_register(reg_bit(x) | reg_bit(sp));
+                        emit(SLOAD, x, z, sp);
+                        release(z);
+                }
+                binary(sp, "+", (Operand) { sp, 0, -1 }, constant(1));
+        }
+        else {
+                fail("cannot parse '%s'", token.kind == T_END ? "" :
+                     token.text);
+        }
+
+        if (token.kind != T_END) {
+                fail("unexpected text after the instruction");
+        }
+}
+
+static void parse_line(void)
+{
+        next();
+        /* any number of "label:" */
+        while (token.kind == T_IDENT && *cursor == ':' && cursor[1] != '=') {
+                define_label(lookup(token.text));
+                cursor++;
+                next();
+        }
+        if (token.kind != T_END) {
+                parse_statement();
+        }
+}
+
+static void assemble_file(const char *path)
+{
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                fprintf(stderr, "umasm: cannot open %s\n", path);
+                exit(EXIT_FAILURE);
+        }
+
+        file_name = path;
+        line_number = 0;
+        current_section = find_section("text");
+        num_temps = 0;
+        zero_reg = NO_REG;
+
+        char line[MAX_LINE];
+        while (fgets(line, sizeof(line), fp) != NULL) {
+                line_number++;
+                cursor = line;
+                parse_line();
+        }
+        fclose(fp);
+}
+
+/************************************************************************
+ *                          Peephole optimizer                          *
+ ************************************************************************/
+
+/* Registers an item reads; a conditional move also reads its destination */
+static unsigned reads(const Item *item)
+{
+        if (item->kind != INSTRUCTION) {
+                return 0;
+        }
+        switch (item->op) {
+                case CMOV:
+                        return reg_bit(item->a) | reg_bit(item->b) |
+                               reg_bit(item->c);
+                case SSTORE:
+                        return reg_bit(item->a) | reg_bit(item->b) |
+                               reg_bit(item->c);
+                case SLOAD: case ADD: case MUL: case DIV: case NAND:
+                case LOADP:
+                        return reg_bit(item->b) | reg_bit(item->c);
+                case MAP: case UNMAP: case OUT:
+                        return reg_bit(item->c);
+                default:
+                        return 0;
+        }
+}
+
+static int written(const Item *item)
+{
+        if (item->kind != INSTRUCTION) {
+                return NO_REG;
+        }
+        switch (item->op) {
+                case CMOV: case SLOAD: case ADD: case MUL: case DIV:
+                case NAND: case LV:
+                        return item->a;
+                case MAP:
+                        return item->b;
+                case IN:
+                        return item->c;
+                default:
+                        return NO_REG;
+        }
+}
+
+/* Nothing after the item runs in the same block */
+static bool ends_block(const Item *item)
+{
+        return item->kind != INSTRUCTION || item->op == LOADP ||
+               item->op == HALT;
+}
+
+/* A register's contents, when a LOAD_VALUE or arithmetic on known values
+   in the same block settled them */
+typedef struct Known {
+        bool known;
+        uint32_t value;
+        int symbol;
+} Known;
+
+static bool holds(const Known *known, uint32_t value, int symbol)
+{
+        return known->known && known->value == value &&
+               known->symbol == symbol;
+}
+
+/* Name: drop_redundant_loads
+*  Purpose: Remove LOAD_VALUEs, and LOAD_VALUE/NAND pairs loading a
+*           complement, of the value the register already holds
+*  Parameters: Section
+*  Returns: Whether anything was removed
+*  Effects: Compacts the section's items
+*/
+static bool drop_redundant_loads(Section *s)
+{
+        Known known[8];
+        memset(known, 0, sizeof(known));
+        int kept = 0;
+
+        for (int i = 0; i < s->length; i++) {
+                Item *item = &s->items[i];
+
+                if (item->kind == INSTRUCTION && item->op == LV) {
+                        int a = item->a;
+                        Item *after = i + 1 < s->length ? item + 1 : NULL;
+                        if (item->symbol == -1 && after != NULL &&
+                            after->kind == INSTRUCTION && after->op == NAND &&
+                            after->a == a && after->b == a && after->c == a &&
+                            holds(&known[a], ~item->offset, -1)) {
+                                i++;
+                                continue;
+                        }
+                        if (holds(&known[a], item->offset, item->symbol)) {
+                                continue;
+                        }
+                        known[a] = (Known) { true, item->offset,
+                                             item->symbol };
+                }
+                else if (item->kind == INSTRUCTION && item->op >= ADD &&
+                         item->op <= NAND) {
+                        Known *b = &known[item->b];
+                        Known *c = &known[item->c];
+                        Known result = { false, 0, -1 };
+                        if (b->known && c->known && b->symbol == -1 &&
+                            c->symbol == -1 &&
+                            (item->op != DIV || c->value != 0)) {
+                                uint32_t x = b->value, y = c->value;
+                                result.known = true;
+                                result.value = item->op == ADD ? x + y :
+                                               item->op == MUL ? x * y :
+                                               item->op == DIV ? x / y :
+                                               ~(x & y);
+                        }
+                        known[item->a] = result;
+                }
+                else if (item->kind == INSTRUCTION && item->op == CMOV) {
+                        Known *a = &known[item->a];
+                        Known *b = &known[item->b];
+                        if (!(a->known && b->known && holds(a, b->value,
+                                                            b->symbol))) {
+                                a->known = false;
+                        }
+                }
+                else if (written(item) != NO_REG) {
+                        known[written(item)].known = false;
+                }
+
+                if (ends_block(item)) {
+                        memset(known, 0, sizeof(known));
+                }
+                s->items[kept++] = *item;
+        }
+
+        bool changed = kept != s->length;
+        s->length = kept;
+        return changed;
+}
+
+/* Name: drop_dead_loads
+*  Purpose: Remove LOAD_VALUEs whose register is overwritten, or the
+*           program halts, before anything in the block reads it
+*  Parameters: Section
+*  Returns: Whether anything was removed
+*  Effects: Compacts the section's items
+*/
+static bool drop_dead_loads(Section *s)
+{
+        int kept = 0;
+
+        for (int i = 0; i < s->length; i++) {
+                Item *item = &s->items[i];
+                bool dead = false;
+
+                if (item->kind == INSTRUCTION && item->op == LV) {
+                        unsigned bit = reg_bit(item->a);
+                        for (int j = i + 1; j < s->length; j++) {
+                                Item *next = &s->items[j];
+                                if (reads(next) & bit) {
+                                        break;
+                                }
+                                if (written(next) == item->a ||
+                                    (next->kind == INSTRUCTION &&
+                                     next->op == HALT)) {
+                                        dead = true;
+                                        break;
+                                }
+                                if (ends_block(next)) {
+                                        break;
+                                }
+                        }
+                }
+
+                if (!dead) {
+                        s->items[kept++] = *item;
+                }
+        }
+
+        bool changed = kept != s->length;
+        s->length = kept;
+        return changed;
+}
+
+/* Whether items i and i + 1 are a macro's jump: LOAD_VALUE of a label
+   into a register, then LOAD_PROGRAM of segment 0 at that register */
+static bool is_jump(const Section *s, int i)
+{
+        if (i + 1 >= s->length) {
+                return false;
+        }
+        const Item *load = &s->items[i];
+        const Item *go = &s->items[i + 1];
+        return load->kind == INSTRUCTION && load->op == LV &&
+               (load->flags & JUMP_TARGET) && load->offset == 0 &&
+               go->kind == INSTRUCTION && go->op == LOADP &&
+               (go->flags & LOCAL_JUMP) && go->c == load->a;
+}
+
+/* Where each label's code starts: the section, and the first item after
+   the label and any labels that follow it */
+typedef struct Place {
+        int section;
+        int item;
+} Place;
+
+static Place *find_code(void)
+{
+        Place *places = malloc((num_symbols + 1) * sizeof(Place));
+        assert(places != NULL);
+        for (int i = 0; i < num_symbols; i++) {
+                places[i].section = -1;
+        }
+        for (int k = 0; k < num_sections; k++) {
+                const Section *s = &sections[k];
+                int start = s->length;
+                for (int i = s->length - 1; i >= 0; i--) {
+                        if (s->items[i].kind != LABEL) {
+                                start = i;
+                                continue;
+                        }
+                        places[s->items[i].symbol] = (Place) { k, start };
+                }
+        }
+        return places;
+}
+
+/* Name: shorten_branches
+*  Purpose: Point a jump whose target is itself a jump at the final target,
+*           fold a conditional jump with both targets the same into a jump,
+*           and remove a jump to the instruction right after it
+*  Parameters: Section
+*  Returns: Whether anything changed
+*  Effects: Compacts the section's items
+*/
+static bool shorten_branches(Section *s)
+{
+        bool changed = false;
+        Place *places = find_code();
+
+        for (int i = 0; i < s->length; i++) {
+                Item *item = &s->items[i];
+                if (item->kind != INSTRUCTION || item->op != LV ||
+                    !(item->flags & JUMP_TARGET) || item->offset != 0) {
+                        continue;
+                }
+                /* a bound on the hops, as jumps may form a loop */
+                for (int hops = 0; hops < 8; hops++) {
+                        Place to = places[item->symbol];
+                        if (to.section < 0 ||
+                            !is_jump(&sections[to.section], to.item)) {
+                                break;
+                        }
+                        int next = sections[to.section].items[to.item].symbol;
+                        if (next == item->symbol) {
+                                break;
+                        }
+                        item->symbol = next;
+                        changed = true;
+                }
+        }
+        free(places);
+
+        int kept = 0;
+        for (int i = 0; i < s->length; i++) {
+                Item *item = &s->items[i];
+
+                /* z := A; t := A; if (d) z := t; goto z  =>  goto A */
+                if (i + 3 < s->length && item[0].kind == INSTRUCTION &&
+                    item[0].op == LV && (item[0].flags & JUMP_TARGET) &&
+                    item[1].kind == INSTRUCTION && item[1].op == LV &&
+                    (item[1].flags & JUMP_TARGET) &&
+                    item[0].symbol == item[1].symbol &&
+                    item[0].offset == item[1].offset &&
+                    item[2].kind == INSTRUCTION && item[2].op == CMOV &&
+                    item[2].a == item[0].a && item[2].b == item[1].a &&
+                    item[3].kind == INSTRUCTION && item[3].op == LOADP &&
+                    item[3].c == item[0].a) {
+                        s->items[kept++] = item[0];
+                        s->items[kept++] = item[3];
+                        i += 3;
+                        changed = true;
+                        continue;
+                }
+
+                /* goto L; L: */
+                if (is_jump(s, i)) {
+                        int j = i + 2;
+                        bool next = false;
+                        while (j < s->length && s->items[j].kind == LABEL) {
+                                if (s->items[j].symbol == item->symbol) {
+                                        next = true;
+                                }
+                                j++;
+                        }
+                        if (next) {
+                                i++;
+                                changed = true;
+                                continue;
+                        }
+                }
+
+                s->items[kept++] = *item;
+        }
+        s->length = kept;
+        return changed;
+}
+
+/* Name: peephole
+*  Purpose: Optimize a section's expanded macros
+*  Parameters: Section
+*  Returns: none
+*  Effects: Repeats the passes until none of them finds anything
+*/
+static void peephole(Section *s)
+{
+        bool changed = true;
+        while (changed) {
+                changed = shorten_branches(s);
+                changed |= drop_redundant_loads(s);
+                changed |= drop_dead_loads(s);
+        }
+}
+
+/************************************************************************
+ *                               Linker                                 *
+ ************************************************************************/
+
+/* Name: link
+*  Purpose: Lay the sections out and give each label its address
+*  Parameters: Section order
+*  Returns: Size of the image in words
+*  Effects: Exits on undefined labels
+*/
+static uint32_t link(const int *order)
+{
+        uint32_t address = 0;
+        for (int k = 0; k < num_sections; k++) {
+                Section *s = &sections[order[k]];
+                for (int i = 0; i < s->length; i++) {
+                        Item *item = &s->items[i];
+                        if (item->kind == LABEL) {
+                                symbols[item->symbol].address = address;
+                        }
+                        else if (item->kind == SPACE) {
+                                address += item->offset;
+                        }
+                        else {
+                                address++;
+                        }
+                }
+        }
+
+        for (int i = 0; i < num_symbols; i++) {
+                if (symbols[i].section == -1) {
+                        file_name = symbols[i].file;
+                        line_number = symbols[i].line;
+                        fail("undefined label %s", symbols[i].name);
+                }
+        }
+        return address;
+}
+
+static uint32_t encode(const Item *item)
+{
+        if (item->kind == WORD) {
+                uint32_t base = item->symbol == -1 ? 0
+                                : symbols[item->symbol].address;
+                return base + item->offset;
+        }
+        if (item->op == LV) {
+                uint32_t value = item->offset;
+                if (item->symbol != -1) {
+                        value += symbols[item->symbol].address;
+                }
+                if (value >= (1u << 25)) {
+                        fprintf(stderr, "umasm: label value %u does not "
+                                "fit in a LOAD_VALUE\n", value);
+                        exit(EXIT_FAILURE);
+                }
+                return (uint32_t) LV << 28 | (uint32_t) item->a << 25 | value;
+        }
+        return (uint32_t) item->op << 28 | item->a << 6 | item->b << 3 |
+               item->c;
+}
+
+static void put_word(uint32_t word, FILE *fp)
+{
+        putc(word >> 24, fp);
+        putc(word >> 16, fp);
+        putc(word >> 8, fp);
+        putc(word, fp);
+}
+
+static void write_image(const int *order, FILE *fp)
+{
+        for (int k = 0; k < num_sections; k++) {
+                const Section *s = &sections[order[k]];
+                for (int i = 0; i < s->length; i++) {
+                        const Item *item = &s->items[i];
+                        if (item->kind == SPACE) {
+                                for (uint32_t n = 0; n < item->offset; n++) {
+                                        put_word(0, fp);
+                                }
+                        }
+                        else if (item->kind != LABEL) {
+                                put_word(encode(item), fp);
+                        }
+                }
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        int first = 1;
+        bool optimize = true;
+        if (first < argc && strcmp(argv[first], "-O0") == 0) {
+                optimize = false;
+                first++;
+        }
+        if (first == argc) {
+                fprintf(stderr, "Usage: %s [-O0] file.ums ...\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        /* init and text come first whatever order they appear in */
+        find_section("init");
+        find_section("text");
+        for (int i = first; i < argc; i++) {
+                assemble_file(argv[i]);
+        }
+
+        int order[MAX_SECTIONS];
+        for (int i = 0; i < num_sections; i++) {
+                order[i] = i;
+        }
+        if (optimize) {
+                for (int i = 0; i < num_sections; i++) {
+                        peephole(&sections[i]);
+                }
+        }
+        link(order);
+        write_image(order, stdout);
+        return EXIT_SUCCESS;
+}
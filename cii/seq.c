@@ -0,0 +1,80 @@
+/* Name: seq.c
+ * Implementation of the out-of-line part of seq.h
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <string.h>
+#include "seq.h"
+
+/* Name: Seq_new
+ * Purpose: Create an empty sequence
+ * Parameters: Expected number of elements (0 if unknown)
+ * Returns: New sequence
+ * Effects: Checked runtime error if hint is negative or allocation fails
+ */
+Seq_T Seq_new(int hint)
+{
+        assert(hint >= 0);
+
+        int capacity = 16;
+        while (capacity < hint) {
+                capacity <<= 1;
+        }
+
+        Seq_T seq = malloc(sizeof(*seq));
+        assert(seq != NULL);
+        seq->array = malloc(capacity * sizeof(void *));
+        assert(seq->array != NULL);
+
+        seq->length = 0;
+        seq->head = 0;
+        seq->mask = capacity - 1;
+
+        return seq;
+}
+
+/* Name: Seq_free
+ * Purpose: Release a sequence (not the elements it points to)
+ * Parameters: Address of the sequence
+ * Returns: none
+ * Effects: Sets *seq to NULL, checked runtime error if seq or *seq is null
+ */
+void Seq_free(Seq_T *seq)
+{
+        assert(seq && *seq);
+
+        free((*seq)->array);
+        free(*seq);
+        *seq = NULL;
+}
+
+/* Name: Seq_expand
+ * Purpose: Double a sequence's capacity, keeping its elements in order
+ * Parameters: Sequence
+ * Returns: none
+ * Effects: Element 0 moves to the start of the new array. Checked runtime
+ *          error if allocation fails.
+ */
+void Seq_expand(Seq_T seq)
+{
+        assert(seq);
+
+        int capacity = seq->mask + 1;
+        void **array = malloc(2 * (size_t) capacity * sizeof(void *));
+        assert(array != NULL);
+
+        /* The elements from head to the end, then the wrapped ones */
+        int first = capacity - seq->head;
+        if (first > seq->length) {
+                first = seq->length;
+        }
+        memcpy(array, seq->array + seq->head, first * sizeof(void *));
+        memcpy(array + first, seq->array,
+               (seq->length - first) * sizeof(void *));
+
+        free(seq->array);
+        seq->array = array;
+        seq->head = 0;
+        seq->mask = 2 * capacity - 1;
+}
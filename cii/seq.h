@@ -0,0 +1,93 @@
+/* Name: seq.h
+ * Interface for seq.c, the subset of Hanson's Seq_T (C Interfaces and
+ * Implementations, ch. 11) that the programs in this tree use. A sequence
+ * is a ring of void pointers whose capacity is a power of two, so indexing
+ * is a mask, and the accessors are inline; only growing the ring and
+ * creating or freeing a sequence are calls. Indexes and emptiness are
+ * checked runtime errors, as in Hanson's.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef SEQ_INCLUDED
+#define SEQ_INCLUDED
+
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct Seq_T {
+        void **array;
+        int length;
+        int head;       /* Index of element 0 in array */
+        int mask;       /* Capacity - 1 */
+} *Seq_T;
+
+extern Seq_T Seq_new(int hint);
+extern void Seq_free(Seq_T *seq);
+
+/* Double the capacity (for the inline adds) */
+extern void Seq_expand(Seq_T seq);
+
+static inline int Seq_length(Seq_T seq)
+{
+        assert(seq);
+        return seq->length;
+}
+
+static inline void *Seq_get(Seq_T seq, int i)
+{
+        assert(seq);
+        assert(i >= 0 && i < seq->length);
+        return seq->array[(seq->head + i) & seq->mask];
+}
+
+static inline void *Seq_put(Seq_T seq, int i, void *x)
+{
+        assert(seq);
+        assert(i >= 0 && i < seq->length);
+        void **slot = &seq->array[(seq->head + i) & seq->mask];
+        void *prev = *slot;
+        *slot = x;
+        return prev;
+}
+
+static inline void *Seq_addhi(Seq_T seq, void *x)
+{
+        assert(seq);
+        if (seq->length > seq->mask) {
+                Seq_expand(seq);
+        }
+        seq->array[(seq->head + seq->length++) & seq->mask] = x;
+        return x;
+}
+
+static inline void *Seq_addlo(Seq_T seq, void *x)
+{
+        assert(seq);
+        if (seq->length > seq->mask) {
+                Seq_expand(seq);
+        }
+        seq->head = (seq->head - 1) & seq->mask;
+        seq->array[seq->head] = x;
+        seq->length++;
+        return x;
+}
+
+static inline void *Seq_remhi(Seq_T seq)
+{
+        assert(seq);
+        assert(seq->length > 0);
+        return seq->array[(seq->head + --seq->length) & seq->mask];
+}
+
+static inline void *Seq_remlo(Seq_T seq)
+{
+        assert(seq);
+        assert(seq->length > 0);
+        void *x = seq->array[seq->head];
+        seq->head = (seq->head + 1) & seq->mask;
+        seq->length--;
+        return x;
+}
+
+#endif
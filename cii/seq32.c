@@ -0,0 +1,80 @@
+/* Name: seq32.c
+ * Implementation of the out-of-line part of seq32.h
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <string.h>
+#include "seq32.h"
+
+/* Name: Seq32_new
+ * Purpose: Create an empty sequence
+ * Parameters: Expected number of elements (0 if unknown)
+ * Returns: New sequence
+ * Effects: Checked runtime error if hint is negative or allocation fails
+ */
+Seq32_T Seq32_new(int hint)
+{
+        assert(hint >= 0);
+
+        int capacity = 16;
+        while (capacity < hint) {
+                capacity <<= 1;
+        }
+
+        Seq32_T seq = malloc(sizeof(*seq));
+        assert(seq != NULL);
+        seq->array = malloc(capacity * sizeof(uint32_t));
+        assert(seq->array != NULL);
+
+        seq->length = 0;
+        seq->head = 0;
+        seq->mask = capacity - 1;
+
+        return seq;
+}
+
+/* Name: Seq32_free
+ * Purpose: Release a sequence
+ * Parameters: Address of the sequence
+ * Returns: none
+ * Effects: Sets *seq to NULL, checked runtime error if seq or *seq is null
+ */
+void Seq32_free(Seq32_T *seq)
+{
+        assert(seq && *seq);
+
+        free((*seq)->array);
+        free(*seq);
+        *seq = NULL;
+}
+
+/* Name: Seq32_expand
+ * Purpose: Double a sequence's capacity, keeping its elements in order
+ * Parameters: Sequence
+ * Returns: none
+ * Effects: Element 0 moves to the start of the new array. Checked runtime
+ *          error if allocation fails.
+ */
+void Seq32_expand(Seq32_T seq)
+{
+        assert(seq);
+
+        int capacity = seq->mask + 1;
+        uint32_t *array = malloc(2 * (size_t) capacity * sizeof(uint32_t));
+        assert(array != NULL);
+
+        /* The elements from head to the end, then the wrapped ones */
+        int first = capacity - seq->head;
+        if (first > seq->length) {
+                first = seq->length;
+        }
+        memcpy(array, seq->array + seq->head, first * sizeof(uint32_t));
+        memcpy(array + first, seq->array,
+               (seq->length - first) * sizeof(uint32_t));
+
+        free(seq->array);
+        seq->array = array;
+        seq->head = 0;
+        seq->mask = 2 * capacity - 1;
+}
@@ -0,0 +1,91 @@
+/* Name: seq32.h
+ * Interface for seq32.c, a sequence of uint32_t with the operations of
+ * seq.h, for the stacks and queues of words that would otherwise be
+ * Seq_Ts of integers cast to pointers: half the memory, and no casts
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef SEQ32_INCLUDED
+#define SEQ32_INCLUDED
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct Seq32_T {
+        uint32_t *array;
+        int length;
+        int head;       /* Index of element 0 in array */
+        int mask;       /* Capacity - 1 */
+} *Seq32_T;
+
+extern Seq32_T Seq32_new(int hint);
+extern void Seq32_free(Seq32_T *seq);
+
+/* Double the capacity (for the inline adds) */
+extern void Seq32_expand(Seq32_T seq);
+
+static inline int Seq32_length(Seq32_T seq)
+{
+        assert(seq);
+        return seq->length;
+}
+
+static inline uint32_t Seq32_get(Seq32_T seq, int i)
+{
+        assert(seq);
+        assert(i >= 0 && i < seq->length);
+        return seq->array[(seq->head + i) & seq->mask];
+}
+
+static inline uint32_t Seq32_put(Seq32_T seq, int i, uint32_t x)
+{
+        assert(seq);
+        assert(i >= 0 && i < seq->length);
+        uint32_t *slot = &seq->array[(seq->head + i) & seq->mask];
+        uint32_t prev = *slot;
+        *slot = x;
+        return prev;
+}
+
+static inline uint32_t Seq32_addhi(Seq32_T seq, uint32_t x)
+{
+        assert(seq);
+        if (seq->length > seq->mask) {
+                Seq32_expand(seq);
+        }
+        seq->array[(seq->head + seq->length++) & seq->mask] = x;
+        return x;
+}
+
+static inline uint32_t Seq32_addlo(Seq32_T seq, uint32_t x)
+{
+        assert(seq);
+        if (seq->length > seq->mask) {
+                Seq32_expand(seq);
+        }
+        seq->head = (seq->head - 1) & seq->mask;
+        seq->array[seq->head] = x;
+        seq->length++;
+        return x;
+}
+
+static inline uint32_t Seq32_remhi(Seq32_T seq)
+{
+        assert(seq);
+        assert(seq->length > 0);
+        return seq->array[(seq->head + --seq->length) & seq->mask];
+}
+
+static inline uint32_t Seq32_remlo(Seq32_T seq)
+{
+        assert(seq);
+        assert(seq->length > 0);
+        uint32_t x = seq->array[seq->head];
+        seq->head = (seq->head + 1) & seq->mask;
+        seq->length--;
+        return x;
+}
+
+#endif
@@ -0,0 +1,72 @@
+/* Name: uarray.c
+ * Implementation of the out-of-line part of uarray.h
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#include <string.h>
+#include "uarray.h"
+
+/* Name: UArray_new
+ * Purpose: Create an array of zeroed elements
+ * Parameters: Number of elements, bytes per element
+ * Returns: New array
+ * Effects: Checked runtime error if length is negative, size is not
+ *          positive, or allocation fails
+ */
+UArray_T UArray_new(int length, int size)
+{
+        assert(length >= 0 && size > 0);
+
+        UArray_T uarray = malloc(sizeof(*uarray));
+        assert(uarray != NULL);
+
+        uarray->length = length;
+        uarray->size = size;
+        /* One extra element so that an empty array still has storage */
+        uarray->array = calloc((size_t) length + 1, size);
+        assert(uarray->array != NULL);
+
+        return uarray;
+}
+
+/* Name: UArray_free
+ * Purpose: Release an array and its elements
+ * Parameters: Address of the array
+ * Returns: none
+ * Effects: Sets *uarray to NULL, checked runtime error if uarray or
+ *          *uarray is null
+ */
+void UArray_free(UArray_T *uarray)
+{
+        assert(uarray && *uarray);
+
+        free((*uarray)->array);
+        free(*uarray);
+        *uarray = NULL;
+}
+
+/* Name: UArray_resize
+ * Purpose: Change the number of elements, keeping the ones that remain
+ * Parameters: Array, new number of elements
+ * Returns: none
+ * Effects: New elements are zeroed. Checked runtime error if length is
+ *          negative or allocation fails.
+ */
+void UArray_resize(UArray_T uarray, int length)
+{
+        assert(uarray);
+        assert(length >= 0);
+
+        size_t size = uarray->size;
+        char *array = realloc(uarray->array, ((size_t) length + 1) * size);
+        assert(array != NULL);
+
+        if (length > uarray->length) {
+                memset(array + (size_t) uarray->length * size, 0,
+                       (size_t) (length - uarray->length) * size);
+        }
+
+        uarray->array = array;
+        uarray->length = length;
+}
@@ -0,0 +1,47 @@
+/* Name: uarray.h
+ * Interface for uarray.c, the subset of Hanson's UArray_T (the unboxed
+ * Array_T of C Interfaces and Implementations, ch. 10) that the programs in
+ * this tree use, with the accessors inline. Elements start zeroed. Indexes
+ * are checked runtime errors, as in Hanson's.
+ * Bradley Chao and Matthew Soto
+ * October 18, 2026
+ */
+
+#ifndef UARRAY_INCLUDED
+#define UARRAY_INCLUDED
+
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct UArray_T {
+        int length;
+        int size;       /* Bytes per element */
+        char *array;
+} *UArray_T;
+
+extern UArray_T UArray_new(int length, int size);
+extern void UArray_free(UArray_T *uarray);
+
+/* Elements past the old length start zeroed */
+extern void UArray_resize(UArray_T uarray, int length);
+
+static inline int UArray_length(UArray_T uarray)
+{
+        assert(uarray);
+        return uarray->length;
+}
+
+static inline int UArray_size(UArray_T uarray)
+{
+        assert(uarray);
+        return uarray->size;
+}
+
+static inline void *UArray_at(UArray_T uarray, int i)
+{
+        assert(uarray);
+        assert(i >= 0 && i < uarray->length);
+        return uarray->array + (size_t) i * uarray->size;
+}
+
+#endif